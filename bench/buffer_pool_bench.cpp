@@ -0,0 +1,123 @@
+// Moves data through a producer/consumer pipeline in 16 KiB blocks, once
+// with BufferPool and once with a heap allocation per block, and reports
+// system allocator calls per GB and peak block memory.
+// Usage: buffer_pool_bench [megabytes] [threads]
+
+#include "buffer_pool.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t BLOCK_SIZE = BufferPool::DEFAULT_BLOCK_SIZE;
+constexpr size_t MAX_BLOCKS = 256;  // 4 MiB in flight
+
+// Bounded queue between one producer and one consumer
+template <typename T>
+class Channel {
+public:
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return items_.size() < MAX_BLOCKS / 2; });
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+    }
+    
+    T pop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return !items_.empty(); });
+        T item = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return item;
+    }
+    
+private:
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::deque<T> items_;
+};
+
+struct Result {
+    double seconds;
+    size_t allocator_calls;
+    size_t peak_bytes;
+};
+
+template <typename Acquire, typename Data>
+double runPipelines(size_t blocks_per_pair, size_t pairs, Acquire acquire, Data data) {
+    using Block = decltype(acquire());
+    auto started = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<Channel<Block>>> channels;
+    for (size_t p = 0; p < pairs; ++p) {
+        channels.push_back(std::make_unique<Channel<Block>>());
+        Channel<Block>& channel = *channels.back();
+        threads.emplace_back([&channel, blocks_per_pair, acquire, data] {
+            for (size_t i = 0; i < blocks_per_pair; ++i) {
+                Block block = acquire();
+                std::memset(data(block), static_cast<int>(i), BLOCK_SIZE);
+                channel.push(std::move(block));
+            }
+        });
+        threads.emplace_back([&channel, blocks_per_pair, data] {
+            volatile char sink = 0;
+            for (size_t i = 0; i < blocks_per_pair; ++i) {
+                Block block = channel.pop();
+                sink = sink + data(block)[BLOCK_SIZE - 1];
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+Result runPool(size_t blocks_per_pair, size_t pairs) {
+    BufferPool pool(BLOCK_SIZE, MAX_BLOCKS);
+    double seconds = runPipelines(blocks_per_pair, pairs,
+                                  [&pool] { return pool.acquire(); },
+                                  [](const BufferHandle& block) { return block.data(); });
+    BufferPoolStats stats = pool.getStats();
+    return {seconds, stats.slab_allocations, stats.blocks_allocated * BLOCK_SIZE};
+}
+
+Result runHeap(size_t blocks_per_pair, size_t pairs) {
+    // Every block is a malloc/free pair. Only the queues bound the blocks in
+    // flight, so the peak reported is their capacity plus one per thread.
+    double seconds = runPipelines(blocks_per_pair, pairs,
+                                  [] { return std::make_unique<char[]>(BLOCK_SIZE); },
+                                  [](const std::unique_ptr<char[]>& block) { return block.get(); });
+    return {seconds, blocks_per_pair * pairs, pairs * (MAX_BLOCKS / 2 + 2) * BLOCK_SIZE};
+}
+
+void print(const char* name, const Result& result, size_t bytes) {
+    double gigabytes = static_cast<double>(bytes) / 1e9;
+    std::printf("%-10s %10.1f %16.1f %14zu\n", name, bytes / 1e6 / result.seconds,
+                result.allocator_calls / gigabytes, result.peak_bytes >> 10);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1024;
+    size_t pairs = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4;
+    size_t blocks_per_pair = megabytes * 1024 * 1024 / BLOCK_SIZE / pairs;
+    size_t bytes = blocks_per_pair * pairs * BLOCK_SIZE;
+    
+    std::printf("%zu MiB through %zu producer/consumer pairs\n", bytes >> 20, pairs);
+    std::printf("%-10s %10s %16s %14s\n", "allocator", "MB/s", "alloc_calls/GB", "peak_KiB");
+    print("pool", runPool(blocks_per_pair, pairs), bytes);
+    print("heap", runHeap(blocks_per_pair, pairs), bytes);
+    return 0;
+}
@@ -0,0 +1,104 @@
+// Compares BencodeDict lookups with the std::map it replaced across
+// dictionary sizes, for torrent-like keys and for the 20-byte info hashes
+// that key scrape responses, and times lenient parsing of dictionaries whose
+// keys arrive in reverse order.
+
+#include "bencode_parser.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t LOOKUPS = 2000000;
+
+std::string makeKey(size_t i) {
+    // Torrent-like keys of varying length sharing prefixes
+    return "key " + std::to_string(i * 7919 % 100003);
+}
+
+template <typename Find>
+double nanosPerLookup(const std::vector<std::string>& queries, Find find) {
+    size_t hits = 0;
+    auto started = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < LOOKUPS; ++i) {
+        hits += find(queries[i % queries.size()]);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    if (hits != LOOKUPS) {
+        std::printf("lookup missed\n");
+    }
+    return seconds * 1e9 / LOOKUPS;
+}
+
+std::string makeInfoHash(size_t i) {
+    std::mt19937_64 random(i);
+    std::string hash(20, '\0');
+    for (auto& byte : hash) {
+        byte = static_cast<char>(random());
+    }
+    return hash;
+}
+
+template <typename MakeKey>
+void benchLookups(size_t size, MakeKey make_key) {
+    bencode::BencodeDict dict;
+    std::map<std::string, std::shared_ptr<bencode::BencodeValue>> map;
+    std::vector<std::string> queries;
+    auto value = std::make_shared<bencode::BencodeValue>(bencode::BencodeInteger(1));
+    for (size_t i = 0; i < size; ++i) {
+        dict[make_key(i)] = value;
+        map[make_key(i)] = value;
+        queries.push_back(make_key(i));
+    }
+    std::shuffle(queries.begin(), queries.end(), std::mt19937(1));
+    
+    double dict_ns = nanosPerLookup(queries, [&dict](const std::string& key) {
+        return dict.find(key) != dict.end();
+    });
+    double map_ns = nanosPerLookup(queries, [&map](const std::string& key) {
+        return map.find(key) != map.end();
+    });
+    std::printf("%-8zu %14.1f %14.1f\n", size, dict_ns, map_ns);
+}
+
+void benchReverseParse(size_t size) {
+    // Zero-padded keys so reverse numeric order is reverse byte order
+    std::string data = "d";
+    for (size_t i = size; i-- > 0;) {
+        char key[24];
+        std::snprintf(key, sizeof(key), "%08zu", i);
+        data += "8:" + std::string(key) + "i" + std::to_string(i) + "e";
+    }
+    data += "e";
+    
+    auto started = std::chrono::steady_clock::now();
+    auto parsed = bencode::BencodeParser::parse(data);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    std::printf("%-8zu %14.2f\n", parsed->asDict().size(), ms);
+}
+
+} // namespace
+
+int main() {
+    std::printf("%-8s %14s %14s\n", "entries", "dict_ns", "std_map_ns");
+    for (size_t size : {4, 8, 16, 64, 256, 4096}) {
+        benchLookups(size, makeKey);
+    }
+    
+    std::printf("\n%-8s %14s %14s\n", "hashes", "dict_ns", "std_map_ns");
+    for (size_t size : {16, 256, 4096}) {
+        benchLookups(size, makeInfoHash);
+    }
+    
+    std::printf("\n%-8s %14s\n", "reversed", "parse_ms");
+    for (size_t size : {1000, 10000, 100000}) {
+        benchReverseParse(size);
+    }
+    return 0;
+}
@@ -0,0 +1,167 @@
+// Writes and reads back a file through each disk backend, then streams the
+// same amount over a loopback TCP connection through each socket backend,
+// in piece-sized batches of 16 KiB blocks. Reports syscalls per GB and CPU
+// time per Gbit moved. Usage: disk_backend_bench [megabytes] [directory]
+
+#include "buffer_pool.hpp"
+#include "disk_io.hpp"
+#include "socket_io.hpp"
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t BLOCK_SIZE = 16 * 1024;
+constexpr size_t BLOCKS_PER_BATCH = 64;  // One 1 MiB piece
+
+double cpuSeconds() {
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+void printRow(const std::string& backend, const char* op, double gigabytes, double seconds,
+              uint64_t syscalls, double cpu) {
+    std::printf("%-11s %-6s %10.1f %14.0f %16.3f\n", backend.c_str(), op, gigabytes * 1e3 / seconds,
+                syscalls / gigabytes, cpu / (gigabytes * 8));
+}
+
+void runPass(DiskBackend& backend, DiskOp op, int fd, size_t total, std::vector<BufferHandle>& blocks) {
+    DiskStats before = backend.getStats();
+    double cpu_before = cpuSeconds();
+    auto started = std::chrono::steady_clock::now();
+    
+    std::vector<DiskRequest> batch;
+    for (uint64_t offset = 0; offset < total; offset += BLOCK_SIZE * BLOCKS_PER_BATCH) {
+        batch.clear();
+        for (size_t i = 0; i < BLOCKS_PER_BATCH; ++i) {
+            batch.push_back({op, fd, offset + i * BLOCK_SIZE, blocks[i].data(), BLOCK_SIZE});
+        }
+        backend.submit(batch);
+    }
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    double cpu = cpuSeconds() - cpu_before;
+    DiskStats after = backend.getStats();
+    double gigabytes = static_cast<double>(after.bytes - before.bytes) / 1e9;
+    printRow(backend.name(), op == DiskOp::READ ? "read" : "write", gigabytes, seconds,
+             after.syscalls - before.syscalls, cpu);
+}
+
+std::vector<BufferHandle> acquireBlocks(BufferPool& pool) {
+    pool.reserve(BLOCKS_PER_BATCH);
+    std::vector<BufferHandle> blocks;
+    for (size_t i = 0; i < BLOCKS_PER_BATCH; ++i) {
+        blocks.push_back(pool.acquire());
+        std::memset(blocks.back().data(), static_cast<int>(i), BLOCK_SIZE);
+    }
+    return blocks;
+}
+
+// Sender and receiver each get their own backend, as two peer connections
+// driven from different threads would
+void runSocketPass(bool prefer_io_uring, size_t zero_copy_threshold, size_t total) {
+    using boost::asio::ip::tcp;
+    auto sender = createSocketBackend(prefer_io_uring, zero_copy_threshold);
+    auto receiver = createSocketBackend(prefer_io_uring, zero_copy_threshold);
+    
+    boost::asio::io_context io;
+    tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    tcp::socket out(io);
+    out.connect(acceptor.local_endpoint());
+    tcp::socket in = acceptor.accept();
+    
+    BufferPool send_pool(BLOCK_SIZE, BLOCKS_PER_BATCH, BLOCKS_PER_BATCH);
+    BufferPool recv_pool(BLOCK_SIZE, BLOCKS_PER_BATCH, BLOCKS_PER_BATCH);
+    std::vector<BufferHandle> send_blocks = acquireBlocks(send_pool);
+    std::vector<BufferHandle> recv_blocks = acquireBlocks(recv_pool);
+    sender->registerBuffers(send_pool.getSlabs());
+    
+    auto batchOf = [](SocketOp op, int fd, std::vector<BufferHandle>& blocks) {
+        std::vector<SocketRequest> batch;
+        for (auto& block : blocks) {
+            batch.push_back({op, fd, block.data(), BLOCK_SIZE});
+        }
+        return batch;
+    };
+    std::vector<SocketRequest> sends = batchOf(SocketOp::SEND, out.native_handle(), send_blocks);
+    std::vector<SocketRequest> recvs = batchOf(SocketOp::RECV, in.native_handle(), recv_blocks);
+    
+    double cpu_before = cpuSeconds();
+    auto started = std::chrono::steady_clock::now();
+    std::thread writer([&] {
+        for (size_t sent = 0; sent < total; sent += BLOCK_SIZE * BLOCKS_PER_BATCH) {
+            sender->submit(sends);
+        }
+    });
+    for (size_t received = 0; received < total; received += BLOCK_SIZE * BLOCKS_PER_BATCH) {
+        receiver->submit(recvs);
+    }
+    writer.join();
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    double cpu = cpuSeconds() - cpu_before;
+    if (std::memcmp(recv_blocks.back().data(), send_blocks.back().data(), BLOCK_SIZE) != 0) {
+        std::fprintf(stderr, "Socket data arrived out of order\n");
+        std::exit(1);
+    }
+    
+    // Both ends count, since a transfer takes a send and a receive
+    SocketStats sent = sender->getStats();
+    SocketStats received = receiver->getStats();
+    printRow(sender->name(), "socket", total / 1e9, seconds, sent.syscalls + received.syscalls, cpu);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1024;
+    std::string dir = argc > 2 ? argv[2] : std::filesystem::temp_directory_path().string();
+    size_t total = megabytes * 1024 * 1024;
+    total -= total % (BLOCK_SIZE * BLOCKS_PER_BATCH);
+    std::string path = dir + "/bittorrent_disk_bench.bin";
+    
+    std::printf("%-11s %-6s %10s %14s %16s\n", "backend", "op", "MB/s", "syscalls/GB", "cpu_s/Gbit");
+    std::string last_backend;
+    for (bool prefer_io_uring : {false, true}) {
+        auto backend = createDiskBackend(prefer_io_uring);
+        if (backend->name() == last_backend) {
+            std::printf("io_uring unavailable, skipped\n");
+            continue;
+        }
+        last_backend = backend->name();
+        
+        BufferPool pool(BLOCK_SIZE, BLOCKS_PER_BATCH, BLOCKS_PER_BATCH);
+        std::vector<BufferHandle> blocks = acquireBlocks(pool);
+        backend->registerBuffers(pool.getSlabs());
+        
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            std::perror(path.c_str());
+            return 1;
+        }
+        runPass(*backend, DiskOp::WRITE, fd, total, blocks);
+        runPass(*backend, DiskOp::READ, fd, total, blocks);
+        ::close(fd);
+        ::unlink(path.c_str());
+    }
+    
+    // Zero-copy only pays off for large sends, so every 16 KiB block qualifies
+    runSocketPass(false, 0, total);
+    if (last_backend == "io_uring") {
+        runSocketPass(true, 0, total);
+        runSocketPass(true, BLOCK_SIZE, total);
+    }
+    return 0;
+}
@@ -0,0 +1,183 @@
+// Streams a file out of a simulated swarm and reports time to first byte and
+// playback stalls. Fake peers run in threads, reserve pieces in the shared
+// PiecePicker, "transfer" them at a fixed rate and write them to PieceStorage;
+// a FileStream plays the file back at a fixed bitrate.
+
+#include "synthetic_torrent.hpp"
+#include "file_stream.hpp"
+#include "piece_picker.hpp"
+#include "piece_storage.hpp"
+#include "torrent_file.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t FILE_SIZE = 32 * 1024 * 1024;
+constexpr size_t PIECE_LENGTH = 256 * 1024;
+constexpr size_t NUM_PEERS = 10;
+constexpr double PEER_RATE = 2.0 * 1024 * 1024;      // Bytes per second per peer
+constexpr double PLAYBACK_RATE = 6.0 * 1024 * 1024;  // Bytes per second
+constexpr size_t READ_SIZE = 64 * 1024;
+constexpr double PEER_AVAILABILITY = 0.6;
+
+struct Scenario {
+    const char* name;
+    bool use_stream;     // false: wait for pieces without setting deadlines
+    size_t read_ahead;   // In pieces
+};
+
+struct Result {
+    double ttfb_ms = 0;
+    size_t stalls = 0;
+    double stalled_ms = 0;
+    double total_s = 0;
+};
+
+class FakeSwarm {
+public:
+    FakeSwarm(const TorrentFile& torrent, PiecePicker& picker, PieceStorage& storage,
+              const std::string& data)
+        : torrent_(torrent), picker_(picker), storage_(storage), data_(data) {
+        std::mt19937 rng(7);
+        std::bernoulli_distribution has(PEER_AVAILABILITY);
+        for (size_t p = 0; p < NUM_PEERS; ++p) {
+            std::vector<bool> bitfield(torrent.getNumPieces());
+            for (size_t i = 0; i < bitfield.size(); ++i) {
+                bitfield[i] = has(rng);
+            }
+            picker_.addPeerBitfield(bitfield);
+            bitfields_.push_back(bitfield);
+        }
+        // Make sure every piece has at least one source
+        for (size_t i = 0; i < torrent.getNumPieces(); ++i) {
+            if (!bitfields_[i % NUM_PEERS][i]) {
+                bitfields_[i % NUM_PEERS][i] = true;
+                picker_.incrementAvailability(i);
+            }
+        }
+    }
+    
+    void start() {
+        for (size_t p = 0; p < NUM_PEERS; ++p) {
+            threads_.emplace_back([this, p] { runPeer(p); });
+        }
+    }
+    
+    ~FakeSwarm() {
+        stop_ = true;
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+    
+private:
+    void runPeer(size_t peer) {
+        while (!stop_ && !picker_.isComplete()) {
+            std::optional<size_t> piece = picker_.reservePiece(bitfields_[peer]);
+            if (!piece) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                continue;
+            }
+            
+            size_t size = torrent_.getPieceSize(*piece);
+            std::this_thread::sleep_for(std::chrono::duration<double>(size / PEER_RATE));
+            storage_.writePiece(*piece, data_.substr(*piece * PIECE_LENGTH, size));
+            picker_.markHave(*piece);
+        }
+    }
+    
+    const TorrentFile& torrent_;
+    PiecePicker& picker_;
+    PieceStorage& storage_;
+    const std::string& data_;
+    std::vector<std::vector<bool>> bitfields_;
+    std::vector<std::thread> threads_;
+    std::atomic<bool> stop_{false};
+};
+
+Result runScenario(const Scenario& scenario, const std::string& dir,
+                   const support::SyntheticTorrent& synthetic) {
+    std::filesystem::remove_all(dir + "/download");
+    TorrentFile torrent(synthetic.torrent_path);
+    PiecePicker picker(torrent.getNumPieces());
+    // The picker is under test, not the disk, so use the portable backend
+    PieceStorage storage(torrent, dir + "/download", nullptr, createDiskBackend(false));
+    FileStream stream(torrent, picker, storage, 0);
+    stream.setReadAhead(scenario.read_ahead * PIECE_LENGTH);
+    
+    using Clock = PiecePicker::Clock;
+    FakeSwarm swarm(torrent, picker, storage, synthetic.data);
+    auto started = Clock::now();
+    swarm.start();
+    
+    Result result;
+    std::vector<char> buffer(READ_SIZE);
+    size_t position = 0;
+    auto playback_start = Clock::now();
+    while (position < FILE_SIZE) {
+        size_t length = std::min(READ_SIZE, FILE_SIZE - position);
+        auto before = Clock::now();
+        if (scenario.use_stream) {
+            size_t stalls = stream.getStats().stalls;
+            stream.read(buffer.data(), length);
+            if (stream.getStats().stalls != stalls) {
+                result.stalls++;
+            }
+        } else {
+            PieceRange needed = torrent.getPieceRange(0, position, length);
+            if (!picker.haveRange(needed)) {
+                result.stalls++;
+                picker.waitForRange(needed, std::chrono::seconds(60));
+            }
+        }
+        auto after = Clock::now();
+        if (position == 0) {
+            result.ttfb_ms = std::chrono::duration<double, std::milli>(after - started).count();
+            playback_start = after;
+        } else {
+            result.stalled_ms += std::chrono::duration<double, std::milli>(after - before).count();
+        }
+        position += length;
+        
+        // Consume at the playback bitrate
+        auto due = playback_start + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(position / PLAYBACK_RATE));
+        std::this_thread::sleep_until(due);
+    }
+    result.total_s = std::chrono::duration<double>(Clock::now() - started).count();
+    return result;
+}
+
+} // namespace
+
+int main() {
+    std::string dir = (std::filesystem::temp_directory_path() / "bittorrent_swarm_bench").string();
+    std::filesystem::remove_all(dir);
+    auto synthetic = support::makeSyntheticTorrent(dir, "stream.bin", {{"stream.bin", FILE_SIZE}}, PIECE_LENGTH);
+    
+    const Scenario scenarios[] = {
+        {"rarest-first, no deadlines", false, 0},
+        {"stream, no read-ahead", true, 0},
+        {"stream, read-ahead 4", true, 4},
+        {"stream, read-ahead 16", true, 16},
+    };
+    
+    std::printf("%zu MiB file, %zu KiB pieces, %zu peers at %.1f MiB/s, playback %.1f MiB/s\n",
+                FILE_SIZE >> 20, PIECE_LENGTH >> 10, NUM_PEERS, PEER_RATE / (1 << 20),
+                PLAYBACK_RATE / (1 << 20));
+    std::printf("%-28s %10s %8s %12s %9s\n", "scenario", "ttfb_ms", "stalls", "stalled_ms", "total_s");
+    for (const auto& scenario : scenarios) {
+        Result result = runScenario(scenario, dir, synthetic);
+        std::printf("%-28s %10.1f %8zu %12.1f %9.2f\n", scenario.name, result.ttfb_ms,
+                    result.stalls, result.stalled_ms, result.total_s);
+    }
+    
+    std::filesystem::remove_all(dir);
+    return 0;
+}
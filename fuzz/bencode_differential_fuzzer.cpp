@@ -0,0 +1,38 @@
+// Differential libFuzzer target: the lenient parser must not accept
+// anything the original parser rejected, and both must agree on the value.
+// The original parser has no depth limit, so it only sees input the new
+// parser already accepted.
+
+#include "bencode_parser.hpp"
+#include "baseline_bencode_parser.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::string input(reinterpret_cast<const char*>(data), size);
+    
+    std::string encoded;
+    try {
+        encoded = bencode::BencodeParser::parse(input)->encode();
+    } catch (const std::runtime_error&) {
+        return 0;
+    }
+    
+    std::string baseline_encoded;
+    try {
+        baseline_encoded = baseline_bencode::BencodeParser::parse(input)->encode();
+    } catch (const std::exception& e) {
+        std::cerr << "Accepted input the original parser rejects: " << e.what() << std::endl;
+        std::abort();
+    }
+    if (encoded != baseline_encoded) {
+        std::cerr << "Parsers disagree:\n  new:      " << encoded
+                  << "\n  original: " << baseline_encoded << std::endl;
+        std::abort();
+    }
+    return 0;
+}
@@ -0,0 +1,31 @@
+// libFuzzer target for the bencode parser. Beyond not crashing, anything
+// the strict parser accepts must re-encode to the exact input, and anything
+// the lenient parser accepts must re-encode to canonical bencode.
+
+#include "bencode_parser.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::string input(reinterpret_cast<const char*>(data), size);
+    
+    try {
+        auto value = bencode::BencodeParser::parse(input, bencode::ParseLimits::strictLimits());
+        if (value->encode() != input) {
+            std::abort();
+        }
+    } catch (const std::runtime_error&) {
+    }
+    
+    try {
+        std::string canonical = bencode::BencodeParser::parse(input)->encode();
+        auto reparsed = bencode::BencodeParser::parse(canonical, bencode::ParseLimits::strictLimits());
+        if (reparsed->encode() != canonical) {
+            std::abort();
+        }
+    } catch (const std::runtime_error&) {
+    }
+    return 0;
+}
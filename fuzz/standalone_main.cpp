@@ -0,0 +1,42 @@
+// Runs a fuzz target over files and directories of inputs, for compilers
+// without libFuzzer. No new inputs are generated; this replays a corpus.
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+namespace {
+
+void runFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t runs = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::filesystem::path path = argv[i];
+        if (std::filesystem::is_directory(path)) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(path)) {
+                if (entry.is_regular_file()) {
+                    runFile(entry.path());
+                    runs++;
+                }
+            }
+        } else {
+            runFile(path);
+            runs++;
+        }
+    }
+    std::printf("Executed %zu inputs\n", runs);
+    return 0;
+}
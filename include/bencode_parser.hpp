@@ -1,10 +1,11 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
-#include <map>
 #include <variant>
 #include <memory>
+#include <utility>
 
 namespace bencode {
 
@@ -15,7 +16,57 @@ class BencodeValue;
 using BencodeInteger = int64_t;
 using BencodeString = std::string;
 using BencodeList = std::vector<std::shared_ptr<BencodeValue>>;
-using BencodeDict = std::map<std::string, std::shared_ptr<BencodeValue>>;
+
+// Dictionary stored as a contiguous vector of entries sorted by key, which
+// keeps canonical encoding order. Lookups take std::string_view and use a
+// linear scan for small dictionaries and binary search otherwise. The first
+// eight bytes of every key are kept as a big-endian integer beside the
+// entries, so most comparisons never touch the key strings.
+class BencodeDict {
+public:
+    using value_type = std::pair<std::string, std::shared_ptr<BencodeValue>>;
+    using iterator = std::vector<value_type>::iterator;
+    using const_iterator = std::vector<value_type>::const_iterator;
+    
+    iterator begin() { return entries_.begin(); }
+    iterator end() { return entries_.end(); }
+    const_iterator begin() const { return entries_.begin(); }
+    const_iterator end() const { return entries_.end(); }
+    
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+    void reserve(size_t count) {
+        entries_.reserve(count);
+        prefixes_.reserve(count);
+    }
+    
+    iterator find(std::string_view key);
+    const_iterator find(std::string_view key) const;
+    size_t count(std::string_view key) const { return find(key) != end() ? 1 : 0; }
+    
+    // Inserts an empty value if the key is missing
+    std::shared_ptr<BencodeValue>& operator[](std::string_view key);
+    
+    // Adds an entry, replacing the value of an existing key. Keys arriving in
+    // sorted order, as from a canonical parse, are appended without a search;
+    // others shift the entries behind them.
+    void insert(std::string key, std::shared_ptr<BencodeValue> value);
+    
+    // Builds a dictionary from entries in any order in O(n log n). Of
+    // duplicate keys the last one wins.
+    static BencodeDict fromEntries(std::vector<value_type> entries);
+    
+private:
+    static constexpr size_t LINEAR_SCAN_LIMIT = 16;
+    
+    // Orders like the keys themselves, except that keys differing only after
+    // their first eight bytes (or in trailing NULs) compare equal
+    static uint64_t keyPrefix(std::string_view key);
+    size_t lowerBound(std::string_view key, uint64_t prefix) const;
+    
+    std::vector<value_type> entries_;
+    std::vector<uint64_t> prefixes_;  // keyPrefix of each entry
+};
 
 // Main bencode value class that can hold any bencoded type
 class BencodeValue {
@@ -43,17 +94,46 @@ private:
     ValueType value_;
 };
 
+// Bounds applied while parsing untrusted input
+struct ParseLimits {
+    size_t max_depth = 100;             // Nesting of lists and dictionaries
+    size_t max_size = 64 * 1024 * 1024; // Input size in bytes
+    size_t max_nodes = 1 << 22;         // Total number of values
+    // Reject non-canonical input: leading zeros, negative zero, unsorted or
+    // duplicate dictionary keys and trailing data after the root value. Off
+    // by default since trackers and peers send such data; .torrent files
+    // need it so the re-encoded info dictionary hashes to the info hash.
+    bool strict = false;
+    
+    static ParseLimits strictLimits() {
+        ParseLimits limits;
+        limits.strict = true;
+        return limits;
+    }
+};
+
 class BencodeParser {
 public:
-    static std::shared_ptr<BencodeValue> parse(const std::string& data);
-    static std::shared_ptr<BencodeValue> parseFile(const std::string& filename);
+    static std::shared_ptr<BencodeValue> parse(const std::string& data,
+                                               const ParseLimits& limits = ParseLimits());
+    static std::shared_ptr<BencodeValue> parseFile(const std::string& filename,
+                                                   const ParseLimits& limits = ParseLimits());
     
 private:
-    static std::shared_ptr<BencodeValue> parseValue(const std::string& data, size_t& pos);
-    static BencodeInteger parseInteger(const std::string& data, size_t& pos);
-    static BencodeString parseString(const std::string& data, size_t& pos);
-    static BencodeList parseList(const std::string& data, size_t& pos);
-    static BencodeDict parseDict(const std::string& data, size_t& pos);
+    struct ParseState {
+        const std::string& data;
+        const ParseLimits& limits;
+        size_t pos;
+        size_t depth;
+        size_t nodes;
+    };
+    
+    static std::shared_ptr<BencodeValue> parseValue(ParseState& state);
+    static BencodeInteger parseInteger(ParseState& state);
+    static BencodeString parseString(ParseState& state);
+    static BencodeList parseList(ParseState& state);
+    static BencodeDict parseDict(ParseState& state);
+    static size_t parseLength(ParseState& state);
 };
 
 } // namespace bencode 
\ No newline at end of file
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include <sys/uio.h>
+
+class BufferPool;
+struct BufferPoolThreadCache;
+
+namespace detail {
+
+struct PoolBlock {
+    char* data;
+    std::atomic<uint32_t> refs{0};
+    size_t length = 0;
+    BufferPool* pool = nullptr;
+};
+
+} // namespace detail
+
+// Reference counted handle to a pool block. Copies share the block, which
+// returns to its pool when the last handle goes away.
+class BufferHandle {
+public:
+    BufferHandle() = default;
+    BufferHandle(const BufferHandle& other);
+    BufferHandle(BufferHandle&& other) noexcept;
+    BufferHandle& operator=(BufferHandle other) noexcept;
+    ~BufferHandle();
+    
+    explicit operator bool() const { return block_ != nullptr; }
+    
+    char* data() const { return block_->data; }
+    size_t size() const { return block_->length; }
+    size_t capacity() const;
+    // Sets the number of valid bytes, at most capacity()
+    void resize(size_t length);
+    
+    uint32_t useCount() const { return block_ ? block_->refs.load(std::memory_order_relaxed) : 0; }
+    
+private:
+    friend class BufferPool;
+    explicit BufferHandle(detail::PoolBlock* block) : block_(block) {}
+    
+    void release();
+    
+    detail::PoolBlock* block_ = nullptr;
+};
+
+struct BufferPoolStats {
+    size_t slab_allocations;  // Calls into the system allocator
+    size_t blocks_allocated;  // Never more than max_blocks
+    size_t blocks_in_use;
+    size_t peak_in_use;
+    size_t acquires;
+    size_t backpressure_waits;
+    size_t cache_steals;      // Times idle thread caches were emptied
+};
+
+// Fixed-size block allocator. Memory comes from the system in slabs of
+// several blocks and is never returned until the pool is destroyed. Each
+// thread keeps a small cache of free blocks so the hot path avoids the pool
+// lock. No more than max_blocks are ever allocated: once they all exist, the
+// pool takes back blocks sitting in other threads' caches instead of growing.
+// acquire() blocks while all max_blocks are in use, which pushes back on
+// whoever is producing data.
+class BufferPool {
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 16 * 1024;
+    
+    explicit BufferPool(size_t block_size = DEFAULT_BLOCK_SIZE,
+                        size_t max_blocks = 4096,
+                        size_t blocks_per_slab = 64);
+    ~BufferPool();
+    
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+    
+    size_t getBlockSize() const { return block_size_; }
+    size_t getMaxBlocks() const { return max_blocks_; }
+    
+    // Allocates slabs up front, e.g. before registering them with the kernel
+    void reserve(size_t blocks);
+    
+    BufferHandle acquire();
+    std::optional<BufferHandle> tryAcquire();
+    std::optional<BufferHandle> acquireFor(std::chrono::steady_clock::duration timeout);
+    
+    // Memory regions backing the pool, suitable for DiskBackend::registerBuffers
+    std::vector<iovec> getSlabs() const;
+    
+    BufferPoolStats getStats() const;
+    
+private:
+    friend class BufferHandle;
+    friend struct BufferPoolThreadCache;
+    
+    struct Slab {
+        std::unique_ptr<char, void (*)(void*)> memory;
+        std::unique_ptr<detail::PoolBlock[]> blocks;
+        size_t count;
+    };
+    
+    BufferPoolThreadCache* adoptThreadCache();
+    BufferHandle makeHandle(detail::PoolBlock* block);
+    bool reserveSlot();
+    detail::PoolBlock* takeBlock();
+    void release(detail::PoolBlock* block);
+    void allocateSlab();
+    void stealCachedBlocks();
+    
+    const size_t block_size_;
+    const size_t max_blocks_;
+    const size_t blocks_per_slab_;
+    
+    mutable std::mutex mutex_;
+    std::condition_variable available_cv_;
+    std::vector<Slab> slabs_;
+    size_t blocks_allocated_ = 0;
+    std::vector<detail::PoolBlock*> free_;
+    // Caches of every thread that used this pool, so their blocks can be
+    // reclaimed when the pool is at its cap
+    std::vector<std::shared_ptr<BufferPoolThreadCache>> caches_;
+    std::atomic<size_t> waiters_{0};
+    
+    std::atomic<size_t> in_use_{0};
+    std::atomic<size_t> peak_in_use_{0};
+    std::atomic<size_t> acquires_{0};
+    size_t slab_allocations_ = 0;
+    size_t backpressure_waits_ = 0;
+    size_t cache_steals_ = 0;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/uio.h>
+
+enum class DiskOp {
+    READ,
+    WRITE
+};
+
+struct DiskRequest {
+    DiskOp op;
+    int fd;
+    uint64_t offset;
+    char* buffer;
+    size_t length;
+};
+
+struct DiskStats {
+    uint64_t requests = 0;  // Requests completed
+    uint64_t bytes = 0;
+    uint64_t syscalls = 0;  // Kernel entries made to complete them
+};
+
+// Executes batches of positional reads and writes. A batch either completes
+// in full or throws; short transfers are retried until done. submit may be
+// called from several threads at once.
+class DiskBackend {
+public:
+    virtual ~DiskBackend() = default;
+    
+    virtual void submit(const std::vector<DiskRequest>& requests) = 0;
+    
+    // Pins long-lived buffers with the kernel where the backend supports it.
+    // Requests whose buffer lies inside a registered region can skip the
+    // per-request page mapping.
+    virtual void registerBuffers(const std::vector<iovec>& buffers) { (void)buffers; }
+    
+    virtual std::string name() const = 0;
+    
+    DiskStats getStats() const {
+        return {requests_.load(std::memory_order_relaxed), bytes_.load(std::memory_order_relaxed),
+                syscalls_.load(std::memory_order_relaxed)};
+    }
+    
+protected:
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> syscalls_{0};
+};
+
+// Portable pread/pwrite path
+class PosixDiskBackend : public DiskBackend {
+public:
+    void submit(const std::vector<DiskRequest>& requests) override;
+    std::string name() const override { return "posix"; }
+};
+
+// io_uring if compiled in and supported by the running kernel, otherwise
+// the portable backend
+std::unique_ptr<DiskBackend> createDiskBackend(bool prefer_io_uring = true);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "torrent_file.hpp"
+#include "piece_picker.hpp"
+#include <cstdint>
+#include <vector>
+
+// Per-file download priorities and the piece priorities they imply. A piece
+// takes the highest priority of the files it overlaps, so pieces straddling
+// a wanted and a skipped file are still downloaded.
+class FileSelection {
+public:
+    explicit FileSelection(const TorrentFile& torrent);
+    
+    void setPriority(size_t file_index, DownloadPriority priority);
+    void setPriorities(const std::vector<DownloadPriority>& priorities);
+    DownloadPriority getPriority(size_t file_index) const;
+    bool isWanted(size_t file_index) const;
+    
+    DownloadPriority getPiecePriority(size_t piece) const;
+    
+    // Files overlapping a piece as a half-open index range
+    std::pair<size_t, size_t> getFilesInPiece(size_t piece) const;
+    
+    // Total size of wanted files
+    uint64_t getWantedBytes() const { return wanted_bytes_; }
+    // Bytes of wanted files in pieces not verified yet; what the tracker
+    // should be told is left
+    uint64_t getBytesLeft(const PiecePicker& picker) const;
+    
+    // Copies the piece priorities into a picker
+    void apply(PiecePicker& picker) const;
+    
+private:
+    void updatePieces(size_t file_index);
+    
+    const TorrentFile& torrent_;
+    std::vector<DownloadPriority> file_priorities_;
+    std::vector<DownloadPriority> piece_priorities_;
+    uint64_t wanted_bytes_;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "torrent_file.hpp"
+#include "piece_picker.hpp"
+#include "piece_storage.hpp"
+#include <chrono>
+#include <set>
+
+struct StreamStats {
+    size_t reads = 0;
+    size_t bytes_read = 0;
+    size_t stalls = 0;  // Reads that had to wait for pieces
+    std::chrono::nanoseconds time_to_first_byte{0};
+    bool first_byte_served = false;
+};
+
+// Reads a single file of an in-progress download. Every read puts deadlines
+// on the pieces it touches plus a read-ahead window, and blocks only until
+// those pieces have been verified. Seeking or closing the stream withdraws
+// the deadlines it set, so abandoned read-ahead does not delay new reads. Data comes through PieceStorage, so files
+// that are skipped and kept in the partfile can be streamed as well.
+class FileStream {
+public:
+    FileStream(const TorrentFile& torrent,
+               PiecePicker& picker,
+               PieceStorage& storage,
+               size_t file_index);
+    ~FileStream();
+    
+    FileStream(const FileStream&) = delete;
+    FileStream& operator=(const FileStream&) = delete;
+    
+    size_t size() const { return file_.length; }
+    size_t tell() const { return position_; }
+    void seek(size_t offset);
+    
+    // Bytes past the read position that get deadlines as well
+    void setReadAhead(size_t bytes) { read_ahead_ = bytes; }
+    // Spacing between the deadlines of consecutive read-ahead pieces
+    void setDeadlineStep(PiecePicker::Clock::duration step) { deadline_step_ = step; }
+    void setTimeout(PiecePicker::Clock::duration timeout) { timeout_ = timeout; }
+    
+    // Returns the number of bytes read, 0 at end of file
+    size_t read(char* buffer, size_t length);
+    
+    const StreamStats& getStats() const { return stats_; }
+    
+private:
+    void scheduleDeadlines(size_t offset, size_t length);
+    void clearDeadlines();
+    
+    const TorrentFile& torrent_;
+    PiecePicker& picker_;
+    PieceStorage& storage_;
+    size_t file_index_;
+    FileInfo file_;
+    size_t position_ = 0;
+    size_t read_ahead_;
+    PiecePicker::Clock::duration deadline_step_;
+    PiecePicker::Clock::duration timeout_;
+    PiecePicker::Clock::time_point opened_at_;
+    std::set<size_t> deadline_pieces_;  // Pieces this stream gave deadlines to
+    StreamStats stats_;
+};
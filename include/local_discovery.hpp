@@ -0,0 +1,60 @@
+#pragma once
+
+#include "tracker_client.hpp"
+#include <boost/asio.hpp>
+#include <array>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Announcement received from another client on the local network
+struct LsdAnnounce {
+    uint16_t port;
+    std::vector<std::string> info_hashes;  // 40 hex characters each
+    std::string cookie;
+};
+
+// Local Service Discovery (BEP 14): announces torrents to, and learns peers
+// from, other clients on the same multicast domain without a tracker
+class LocalServiceDiscovery {
+public:
+    static constexpr const char* MULTICAST_ADDRESS = "239.192.152.143";
+    static constexpr uint16_t MULTICAST_PORT = 6771;
+    // Wait before receiving again after a socket error, so a persistent
+    // error cannot spin the event loop
+    static constexpr std::chrono::seconds RECEIVE_RETRY_DELAY{1};
+    
+    // Called with the hex info hash and the announcing peer
+    using PeerHandler = std::function<void(const std::string&, const Peer&)>;
+    
+    LocalServiceDiscovery(boost::asio::io_context& io,
+                          uint16_t listen_port,
+                          PeerHandler handler,
+                          const std::string& multicast_address = MULTICAST_ADDRESS,
+                          uint16_t multicast_port = MULTICAST_PORT);
+    
+    // Multicasts a BT-SEARCH for the given hex info hashes
+    void announce(const std::vector<std::string>& info_hashes);
+    void close();
+    
+    static std::string buildAnnounce(const std::string& host,
+                                     uint16_t port,
+                                     const std::vector<std::string>& info_hashes,
+                                     const std::string& cookie);
+    static std::optional<LsdAnnounce> parseAnnounce(const std::string& message);
+    
+private:
+    void startReceive();
+    void handleMessage(const std::string& message, const boost::asio::ip::address& sender);
+    
+    boost::asio::ip::udp::socket socket_;
+    boost::asio::steady_timer retry_timer_;
+    boost::asio::ip::udp::endpoint multicast_endpoint_;
+    boost::asio::ip::udp::endpoint sender_;
+    std::array<char, 1500> buffer_;
+    uint16_t listen_port_;
+    std::string cookie_;
+    PeerHandler handler_;
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <iostream>
 #include <sstream>
@@ -11,9 +12,17 @@ enum class LogLevel {
     ERROR
 };
 
+// Messages below the current level (INFO unless changed) are dropped
 class Logger {
 public:
+    static void setLevel(LogLevel level) { minLevel().store(level, std::memory_order_relaxed); }
+    static LogLevel getLevel() { return minLevel().load(std::memory_order_relaxed); }
+    
     static void log(LogLevel level, const std::string& message) {
+        if (level < getLevel()) {
+            return;
+        }
+        
         std::string level_str;
         switch (level) {
             case LogLevel::DEBUG:   level_str = "DEBUG"; break;
@@ -29,4 +38,10 @@ public:
     static void info(const std::string& message) { log(LogLevel::INFO, message); }
     static void warning(const std::string& message) { log(LogLevel::WARNING, message); }
     static void error(const std::string& message) { log(LogLevel::ERROR, message); }
+    
+private:
+    static std::atomic<LogLevel>& minLevel() {
+        static std::atomic<LogLevel> level{LogLevel::INFO};
+        return level;
+    }
 }; 
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include <sys/uio.h>
+
+// Message Stream Encryption / Protocol Encryption primitives: the DH key
+// exchange, the derived handshake hashes and the RC4 stream ciphers
+namespace mse {
+
+constexpr size_t KEY_SIZE = 96;          // 768-bit DH values
+constexpr size_t MAX_PADDING = 512;
+constexpr size_t RC4_DISCARD = 1024;     // Keystream bytes dropped after keying
+
+// crypto_provide / crypto_select bits
+enum CryptoMethod : uint32_t {
+    CRYPTO_PLAINTEXT = 0x01,
+    CRYPTO_RC4 = 0x02
+};
+
+// 8 zero bytes that both sides encrypt to find the start of the RC4 stream
+const std::string& verificationConstant();
+
+// Random padding of 0 to MAX_PADDING bytes
+std::string makePadding();
+
+class Rc4Cipher {
+public:
+    Rc4Cipher(const unsigned char* key, size_t length);
+    
+    void discard(size_t length);
+    
+    // Encrypts or decrypts in place
+    void apply(char* data, size_t length);
+    void apply(const iovec* buffers, size_t count);
+    
+private:
+    std::array<uint8_t, 256> state_;
+    uint8_t i_ = 0;
+    uint8_t j_ = 0;
+};
+
+class KeyExchange {
+public:
+    KeyExchange();
+    
+    // Our public value Y = G^X mod P, KEY_SIZE bytes big-endian
+    const std::string& getPublicKey() const { return public_key_; }
+    
+    // Shared secret S from the peer's public value; throws if it is invalid
+    std::string computeSecret(const std::string& peer_public_key) const;
+    
+private:
+    std::string private_key_;
+    std::string public_key_;
+};
+
+// HASH('req1', S), sent by the initiator to mark the end of its padding
+std::string req1Hash(const std::string& secret);
+// HASH('req2', SKEY) xor HASH('req3', S), identifies the torrent
+std::string req2Req3Hash(const std::string& secret, const std::string& skey);
+
+// Both directions of an encrypted connection after the key exchange.
+// skey is the raw 20-byte info hash.
+class CipherStream {
+public:
+    CipherStream(const std::string& secret, const std::string& skey, bool initiator);
+    
+    void encrypt(char* data, size_t length) { send_.apply(data, length); }
+    void decrypt(char* data, size_t length) { receive_.apply(data, length); }
+    void encrypt(const iovec* buffers, size_t count) { send_.apply(buffers, count); }
+    void decrypt(const iovec* buffers, size_t count) { receive_.apply(buffers, count); }
+    
+private:
+    Rc4Cipher send_;
+    Rc4Cipher receive_;
+};
+
+struct HandshakeResult {
+    CryptoMethod method;                 // What the responder selected
+    std::string skey;                    // Info hash of the torrent
+    std::string initial_payload;         // IA from the initiator, decrypted
+    std::optional<CipherStream> cipher;  // Set when RC4 was selected
+};
+
+// The MSE handshake over a connected, blocking stream socket:
+//   A->B  Ya, PadA
+//   B->A  Yb, PadB
+//   A->B  HASH('req1', S), HASH('req2', SKEY) xor HASH('req3', S),
+//         ENCRYPT(VC, crypto_provide, len(PadC), PadC, len(IA), IA)
+//   B->A  ENCRYPT(VC, crypto_select, len(PadD), PadD)
+// Each side finds the end of the other's random padding by scanning for
+// the next field it can predict. Throws std::runtime_error on a malformed
+// or unacceptable handshake; the caller should then drop the connection.
+
+// Runs the initiator side. initial_payload (at most 65535 bytes) travels
+// encrypted inside the handshake, usually the BitTorrent handshake.
+HandshakeResult initiateHandshake(int fd, const std::string& skey, uint32_t crypto_provide,
+                                  const std::string& initial_payload = "");
+// Runs the responder side for any of the given info hashes, selecting RC4
+// over plaintext when both sides allow it
+HandshakeResult respondHandshake(int fd, const std::vector<std::string>& skeys, uint32_t crypto_allowed);
+
+} // namespace mse
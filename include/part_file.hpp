@@ -0,0 +1,42 @@
+#pragma once
+
+#include "disk_io.hpp"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Stores the bytes of wanted pieces that belong to skipped files, so those
+// files never have to be created. Only pieces that actually receive such
+// bytes get a piece-sized slot. The file starts with a table of one 32-bit
+// slot number per piece (0 = none), which makes it survive restarts. Freed
+// slots are reused before the file grows. Not thread-safe.
+class PartFile {
+public:
+    PartFile(const std::string& path, size_t num_pieces, size_t piece_length);
+    ~PartFile();
+    
+    PartFile(const PartFile&) = delete;
+    PartFile& operator=(const PartFile&) = delete;
+    
+    bool hasPiece(size_t piece) const { return piece < slots_.size() && slots_[piece] != 0; }
+    
+    // Translates a range inside a piece to a request against the partfile.
+    // Writes allocate a slot; reads of a piece without one return nullopt.
+    std::optional<DiskRequest> map(DiskOp op, size_t piece, size_t offset, char* buffer, size_t length);
+    
+    // Drops the slot of a piece whose bytes now all live in real files
+    void freePiece(size_t piece);
+    
+private:
+    void open();
+    uint64_t slotOffset(uint32_t slot) const;
+    void writeSlotEntry(size_t piece, uint32_t slot);
+    
+    std::string path_;
+    size_t piece_length_;
+    int fd_ = -1;
+    std::vector<uint32_t> slots_;
+    uint32_t num_slots_ = 0;
+    std::vector<uint32_t> free_slots_;
+};
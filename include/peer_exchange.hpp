@@ -0,0 +1,72 @@
+#pragma once
+
+#include "tracker_client.hpp"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Flags carried in added.f for each added peer (BEP 11)
+enum PexFlags : uint8_t {
+    PEX_PREFERS_ENCRYPTION = 0x01,
+    PEX_SEED = 0x02,
+    PEX_SUPPORTS_UTP = 0x04,
+    PEX_HOLEPUNCH = 0x08,
+    PEX_REACHABLE = 0x10
+};
+
+// Payload of a ut_pex extension message
+struct PexMessage {
+    std::vector<Peer> added;
+    std::vector<uint8_t> added_flags;  // One entry per added peer
+    std::vector<Peer> dropped;
+};
+
+class PeerExchange {
+public:
+    static std::string encode(const PexMessage& message);
+    static PexMessage decode(const std::string& payload);
+};
+
+// Known peers of one torrent, fed by the tracker, PEX and local discovery.
+// Merges from a single source are rate limited and capped so a chatty or
+// malicious peer cannot flood the list.
+class PeerList {
+public:
+    using Clock = std::chrono::steady_clock;
+    
+    // BEP 11: at most one message per minute and 50 added peers per message
+    static constexpr size_t MAX_PEX_PEERS = 50;
+    
+    explicit PeerList(size_t max_peers = 1000,
+                      Clock::duration min_merge_interval = std::chrono::seconds(60));
+    
+    // Adds peers from a trusted source such as the tracker
+    size_t add(const std::vector<Peer>& peers);
+    void remove(const Peer& peer);
+    
+    // Applies a PEX message received from a peer. Returns the number of new
+    // peers, or 0 if the source sent another message too soon.
+    size_t mergePex(const std::string& source, const PexMessage& message, Clock::time_point now = Clock::now());
+    
+    // Builds the delta against what was last sent to a peer and records the
+    // current list as sent
+    PexMessage makeDelta(const std::string& destination);
+    
+    std::vector<Peer> getPeers() const;
+    size_t size() const { return peers_.size(); }
+    
+private:
+    using Endpoint = std::pair<std::string, uint16_t>;
+    
+    bool insert(const Peer& peer, uint8_t flags);
+    
+    size_t max_peers_;
+    Clock::duration min_merge_interval_;
+    std::map<Endpoint, uint8_t> peers_;
+    std::map<std::string, Clock::time_point> last_merge_;
+    std::map<std::string, std::set<Endpoint>> last_sent_;
+};
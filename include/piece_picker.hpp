@@ -0,0 +1,88 @@
+#pragma once
+
+#include "piece_range.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
+
+// Download priority of a file or piece; SKIP pieces are never picked
+// unless they carry a deadline
+enum class DownloadPriority : uint8_t {
+    SKIP = 0,
+    LOW = 1,
+    NORMAL = 4,
+    HIGH = 7
+};
+
+// Tracks which pieces we have, how many peers have each piece, which are
+// being downloaded and which carry a deadline. Deadline pieces are always
+// picked before the rarest-first (or sequential) order, earliest deadline
+// first. Otherwise higher priority pieces are picked first. Reserved pieces
+// are in flight from some source and are not picked again.
+class PiecePicker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit PiecePicker(size_t num_pieces);
+
+    size_t getNumPieces() const { return have_.size(); }
+    size_t getNumHave() const;
+    bool isComplete() const;
+
+    // Availability bookkeeping, driven by peer bitfield/have messages
+    void incrementAvailability(size_t index);
+    void decrementAvailability(size_t index);
+    void addPeerBitfield(const std::vector<bool>& bitfield);
+    void removePeerBitfield(const std::vector<bool>& bitfield);
+
+    // Called once a piece passed hash verification; wakes up waiters
+    void markHave(size_t index);
+    bool havePiece(size_t index) const;
+    bool haveRange(const PieceRange& range) const;
+
+    // Deadlines pre-empt the normal ordering. Setting a deadline on a piece
+    // that already has one keeps the earlier of the two.
+    void setDeadline(size_t index, Clock::time_point deadline);
+    void clearDeadline(size_t index);
+    void clearDeadlines();
+
+    void setPriority(size_t index, DownloadPriority priority);
+    DownloadPriority getPriority(size_t index) const;
+    
+    // In sequential mode non-deadline pieces are picked lowest index first
+    void setSequential(bool sequential);
+    bool isSequential() const;
+
+    // Next piece to request from a peer advertising the given bitfield
+    std::optional<size_t> pickPiece(const std::vector<bool>& peer_has) const;
+    
+    // Picks a piece and marks it in flight in one step, so concurrent
+    // downloaders never fetch the same piece. The reservation ends with
+    // markHave, or releasePiece if the download failed.
+    std::optional<size_t> reservePiece(const std::vector<bool>& peer_has);
+    void releasePiece(size_t index);
+    bool isReserved(size_t index) const;
+
+    // Block until every piece in range is verified. Returns false on timeout.
+    bool waitForRange(const PieceRange& range, Clock::duration timeout) const;
+
+private:
+    void checkIndex(size_t index) const;
+    std::optional<size_t> pickLocked(const std::vector<bool>& peer_has) const;
+
+    mutable std::mutex mutex_;
+    mutable std::condition_variable have_cv_;
+    std::vector<bool> have_;
+    std::vector<bool> reserved_;
+    std::vector<uint32_t> availability_;
+    std::vector<DownloadPriority> priorities_;
+    std::vector<std::optional<Clock::time_point>> deadlines_;
+    std::set<std::pair<Clock::time_point, size_t>> deadline_queue_;
+    size_t num_have_ = 0;
+    bool sequential_ = false;
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+
+// Half-open range of piece indices [first, last)
+struct PieceRange {
+    size_t first;
+    size_t last;
+
+    bool empty() const { return first >= last; }
+    size_t size() const { return empty() ? 0 : last - first; }
+};
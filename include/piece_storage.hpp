@@ -0,0 +1,102 @@
+#pragma once
+
+#include "torrent_file.hpp"
+#include "disk_io.hpp"
+#include "buffer_pool.hpp"
+#include "file_selection.hpp"
+#include "part_file.hpp"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+// Maps pieces onto the files of a torrent inside a download directory and
+// moves data through a DiskBackend. With a FileSelection, skipped files are
+// not created; their share of boundary pieces goes to a partfile instead.
+// Files are opened on first use and at most getMaxOpenFiles() stay open, the
+// least recently used being closed first. Reads never create files: a file
+// not written yet reads as zeros. Safe to use from several threads.
+class PieceStorage {
+public:
+    static constexpr size_t DEFAULT_MAX_OPEN_FILES = 256;
+    
+    PieceStorage(const TorrentFile& torrent,
+                 const std::string& download_dir,
+                 const FileSelection* selection = nullptr,
+                 std::unique_ptr<DiskBackend> backend = createDiskBackend());
+    ~PieceStorage();
+    
+    PieceStorage(const PieceStorage&) = delete;
+    PieceStorage& operator=(const PieceStorage&) = delete;
+    
+    void writeBlock(size_t piece, size_t offset, const char* data, size_t length);
+    void readBlock(size_t piece, size_t offset, char* data, size_t length);
+    
+    // Zero-copy variants for blocks travelling between pipeline stages
+    void writeBlock(size_t piece, size_t offset, const BufferHandle& block);
+    BufferHandle readBlock(size_t piece, size_t offset, size_t length, BufferPool& pool);
+    
+    // Reads a byte range of one file, wherever its pieces are stored
+    void readFile(size_t file_index, uint64_t offset, char* data, size_t length);
+    
+    // Lets the disk backend pin the pool's slabs; call after BufferPool::reserve
+    void registerBufferPool(const BufferPool& pool);
+    
+    void writePiece(size_t piece, const std::string& data);
+    std::string readPiece(size_t piece);
+    
+    // Reads the piece back and compares it with its SHA1 from the torrent
+    bool verifyPiece(size_t piece);
+    
+    // Creates files that became wanted and moves their data out of the partfile
+    void updateFileSelection();
+    
+    // Files in use by an in-flight request stay open even past the limit
+    void setMaxOpenFiles(size_t max_open_files);
+    size_t getMaxOpenFiles() const;
+    size_t getNumOpenFiles() const;
+    
+    const DiskBackend& getBackend() const { return *backend_; }
+    
+private:
+    struct OpenFile {
+        int fd = -1;
+        size_t pins = 0;  // Requests currently using fd
+        std::list<size_t>::iterator lru;
+    };
+    
+    // Requests for a byte range plus the files they keep open
+    struct MappedRange {
+        std::vector<DiskRequest> requests;
+        std::vector<size_t> pinned;
+    };
+    
+    void checkBlock(size_t piece, size_t offset, size_t length) const;
+    void transfer(DiskOp op, uint64_t offset, char* buffer, size_t length);
+    MappedRange mapRange(DiskOp op, uint64_t offset, char* buffer, size_t length);
+    void unpin(const std::vector<size_t>& files);
+    void mapPartFile(DiskOp op, uint64_t offset, char* buffer, size_t length, MappedRange& range);
+    // Opens the file if needed and keeps it open until unpinned. Without
+    // create, returns -1 if the file is missing or shorter than in the torrent.
+    int pinFile(size_t file_index, bool create);
+    void closeIdleFiles(size_t max_open);
+    void moveFromPartFile(size_t file_index);
+    
+    const TorrentFile& torrent_;
+    std::string download_dir_;
+    const FileSelection* selection_;
+    std::unique_ptr<DiskBackend> backend_;
+    
+    // Shared by transfers; held exclusively while data moves between the
+    // partfile and real files so no transfer sees a half-moved piece
+    std::shared_mutex io_mutex_;
+    // Guards everything below
+    mutable std::mutex mutex_;
+    std::vector<bool> on_disk_;  // File is stored as itself, not in the partfile
+    std::vector<OpenFile> files_;
+    std::list<size_t> lru_;      // Open files, most recently used first
+    size_t max_open_files_ = DEFAULT_MAX_OPEN_FILES;
+    PartFile part_file_;
+};
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/uio.h>
+
+enum class SocketOp {
+    SEND,
+    RECV
+};
+
+struct SocketRequest {
+    SocketOp op;
+    int fd;
+    char* buffer;
+    size_t length;
+};
+
+struct SocketStats {
+    uint64_t requests = 0;  // Requests completed
+    uint64_t bytes = 0;
+    uint64_t syscalls = 0;  // Kernel entries made to complete them
+    uint64_t zero_copy_sends = 0;
+};
+
+// Moves peer wire data through connected stream sockets in batches. Each
+// request sends or receives exactly its length; requests on the same socket
+// complete in order. A batch either completes in full or throws, also when
+// the peer closes the connection. A batch holds the backend until it
+// completes, so a thread that both sends and receives on a connection to
+// itself needs a backend per direction.
+class SocketBackend {
+public:
+    virtual ~SocketBackend() = default;
+    
+    virtual void submit(const std::vector<SocketRequest>& requests) = 0;
+    
+    // Pins long-lived buffers with the kernel where the backend supports it;
+    // zero-copy sends from inside them skip the per-request page mapping
+    virtual void registerBuffers(const std::vector<iovec>& buffers) { (void)buffers; }
+    
+    virtual std::string name() const = 0;
+    
+    SocketStats getStats() const {
+        return {requests_.load(std::memory_order_relaxed), bytes_.load(std::memory_order_relaxed),
+                syscalls_.load(std::memory_order_relaxed), zero_copy_sends_.load(std::memory_order_relaxed)};
+    }
+    
+protected:
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> syscalls_{0};
+    std::atomic<uint64_t> zero_copy_sends_{0};
+};
+
+// Portable send/recv path; waits with poll on non-blocking sockets
+class PosixSocketBackend : public SocketBackend {
+public:
+    void submit(const std::vector<SocketRequest>& requests) override;
+    std::string name() const override { return "posix"; }
+};
+
+// io_uring if compiled in and supported by the running kernel, otherwise
+// the portable backend. Sends of at least zero_copy_threshold bytes use
+// IORING_OP_SEND_ZC where the kernel has it; 0 turns zero-copy off.
+std::unique_ptr<SocketBackend> createSocketBackend(bool prefer_io_uring = true,
+                                                   size_t zero_copy_threshold = 16 * 1024);
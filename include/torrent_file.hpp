@@ -1,6 +1,7 @@
 #pragma once
 
 #include "bencode_parser.hpp"
+#include "piece_range.hpp"
 #include <string>
 #include <vector>
 #include <memory>
@@ -18,6 +19,7 @@ struct TorrentInfo {
     std::vector<FileInfo> files;
     size_t total_length;
     std::string info_hash;  // SHA1 hash of the info dictionary
+    bool multi_file;        // Files live in a directory named after the torrent
 };
 
 class TorrentFile {
@@ -26,6 +28,7 @@ public:
     
     // Getters for torrent metadata
     const std::vector<std::string>& getAnnounceUrls() const { return announce_urls_; }
+    const std::vector<std::string>& getWebSeeds() const { return web_seeds_; }
     const TorrentInfo& getInfo() const { return info_; }
     const std::string& getComment() const { return comment_; }
     const std::string& getCreatedBy() const { return created_by_; }
@@ -35,14 +38,27 @@ public:
     std::string getInfoHash() const;
     size_t getNumPieces() const;
     std::string getPieceHash(size_t index) const;
+    size_t getPieceSize(size_t index) const;
+    
+    // Pieces covering a byte range of one file (offset is relative to the file)
+    PieceRange getPieceRange(size_t file_index, size_t offset, size_t length) const;
+    
+    // Index of the file containing a byte of the torrent, found by binary
+    // search over the file offsets
+    size_t getFileIndexAt(uint64_t offset) const;
+    
+    // Location of a file on disk once downloaded into download_dir
+    std::string getFilePath(size_t file_index, const std::string& download_dir) const;
     
 private:
     void parseAnnounceUrls(const bencode::BencodeDict& dict);
+    void parseWebSeeds(const bencode::BencodeDict& dict);
     void parseInfo(const bencode::BencodeDict& dict);
     void parseFiles(const bencode::BencodeDict& info_dict);
     std::string calculateInfoHash(const bencode::BencodeDict& info_dict);
     
     std::vector<std::string> announce_urls_;
+    std::vector<std::string> web_seeds_;  // BEP 19 url-list
     TorrentInfo info_;
     std::string comment_;
     std::string created_by_;
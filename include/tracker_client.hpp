@@ -45,6 +45,7 @@ public:
     // Utility methods
     static std::string urlEncode(const std::string& str);
     static std::vector<Peer> parseCompactPeers(const std::string& peers_str);
+    static std::string encodeCompactPeers(const std::vector<Peer>& peers);
     static std::vector<Peer> parseBencodedPeers(const std::string& peers_str);
     
 private:
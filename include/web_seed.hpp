@@ -0,0 +1,104 @@
+#pragma once
+
+#include "torrent_file.hpp"
+#include "piece_picker.hpp"
+#include "piece_storage.hpp"
+#include <curl/curl.h>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct WebSeedStats {
+    uint64_t bytes_downloaded = 0;
+    size_t requests = 0;
+    size_t pieces_verified = 0;
+    size_t pieces_failed = 0;
+    double seconds = 0;
+    
+    double megabytesPerSecond() const {
+        return seconds > 0 ? bytes_downloaded / seconds / (1024 * 1024) : 0;
+    }
+};
+
+// Downloads pieces from BEP 19 web seeds (the torrent's url-list). Each
+// piece is split into HTTP Range requests per file it spans; several
+// keep-alive connections per seed run concurrently through a curl multi
+// handle. Pieces are reserved in the shared PiecePicker while in flight,
+// so web seed and peer downloads never fetch the same piece twice, and are
+// verified against the torrent's SHA1 before being stored.
+class WebSeedClient {
+public:
+    static constexpr long DEFAULT_STALL_TIMEOUT = 30;  // Seconds
+    static constexpr long STALL_BYTES_PER_SECOND = 1024;
+    
+    WebSeedClient(const TorrentFile& torrent,
+                  PieceStorage& storage,
+                  PiecePicker& picker,
+                  const std::vector<std::string>& urls,
+                  size_t connections_per_seed = 4);
+    ~WebSeedClient();
+    
+    WebSeedClient(const WebSeedClient&) = delete;
+    WebSeedClient& operator=(const WebSeedClient&) = delete;
+    
+    // Runs until the picker has nothing left to give or max_pieces pieces
+    // were verified. Returns the number of pieces verified.
+    size_t run(size_t max_pieces = std::numeric_limits<size_t>::max());
+    
+    // A seed that takes longer than this to connect, or sends less than
+    // STALL_BYTES_PER_SECOND for this long, fails the piece it was serving
+    void setStallTimeout(long seconds);
+    long getStallTimeout() const { return stall_timeout_; }
+    
+    const WebSeedStats& getStats() const { return stats_; }
+    
+    static std::string buildFileUrl(const std::string& base_url, const TorrentInfo& info, size_t file_index);
+    
+private:
+    static constexpr size_t MAX_PIECE_ATTEMPTS = 3;
+    static constexpr size_t MAX_SEED_FAILURES = 5;
+    
+    struct Segment {
+        size_t file_index;
+        uint64_t offset;     // Within the file
+        size_t length;
+        size_t piece_offset; // Where the data lands in the piece buffer
+    };
+    
+    struct Connection {
+        CURL* handle = nullptr;
+        size_t seed = 0;
+        std::optional<size_t> piece;
+        std::vector<Segment> segments;
+        size_t next_segment = 0;
+        size_t received = 0;  // Bytes of the current segment
+        std::string data;
+    };
+    
+    struct Seed {
+        std::string url;
+        size_t failures = 0;         // Consecutive failed pieces
+        std::vector<bool> has;       // Cleared for pieces this seed keeps corrupting
+        std::vector<uint8_t> attempts;
+    };
+    
+    bool startPiece(Connection& connection);
+    void startSegment(Connection& connection);
+    void handleDone(Connection& connection, CURLcode result);
+    void finishPiece(Connection& connection, bool success);
+    std::vector<Segment> mapPiece(size_t piece) const;
+    
+    static size_t writeCallback(char* data, size_t size, size_t nmemb, void* userp);
+    
+    const TorrentFile& torrent_;
+    PieceStorage& storage_;
+    PiecePicker& picker_;
+    CURLM* multi_;
+    std::vector<Seed> seeds_;
+    std::vector<std::unique_ptr<Connection>> connections_;
+    size_t target_ = 0;
+    long stall_timeout_ = DEFAULT_STALL_TIMEOUT;
+    WebSeedStats stats_;
+};
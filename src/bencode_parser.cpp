@@ -1,10 +1,118 @@
 #include "bencode_parser.hpp"
 #include "logger.hpp"
+#include <algorithm>
 #include <fstream>
 #include <stdexcept>
+#include <limits>
 
 namespace bencode {
 
+uint64_t BencodeDict::keyPrefix(std::string_view key) {
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        prefix = (prefix << 8) | (i < key.size() ? static_cast<unsigned char>(key[i]) : 0);
+    }
+    return prefix;
+}
+
+size_t BencodeDict::lowerBound(std::string_view key, uint64_t prefix) const {
+    size_t first = 0;
+    size_t count = entries_.size();
+    while (count > 0) {
+        size_t half = count / 2;
+        size_t mid = first + half;
+        bool less = prefixes_[mid] < prefix ||
+                    (prefixes_[mid] == prefix && std::string_view(entries_[mid].first) < key);
+        if (less) {
+            first = mid + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+    return first;
+}
+
+BencodeDict::const_iterator BencodeDict::find(std::string_view key) const {
+    uint64_t prefix = keyPrefix(key);
+    if (entries_.size() <= LINEAR_SCAN_LIMIT) {
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            if (prefixes_[i] == prefix && entries_[i].first == key) {
+                return entries_.begin() + i;
+            }
+        }
+        return entries_.end();
+    }
+    
+    size_t i = lowerBound(key, prefix);
+    return i < entries_.size() && prefixes_[i] == prefix && entries_[i].first == key ? entries_.begin() + i
+                                                                                     : entries_.end();
+}
+
+BencodeDict::iterator BencodeDict::find(std::string_view key) {
+    auto it = static_cast<const BencodeDict&>(*this).find(key);
+    return entries_.begin() + (it - entries_.cbegin());
+}
+
+std::shared_ptr<BencodeValue>& BencodeDict::operator[](std::string_view key) {
+    uint64_t prefix = keyPrefix(key);
+    size_t i = lowerBound(key, prefix);
+    if (i == entries_.size() || entries_[i].first != key) {
+        // Both vectors must stay the same length even if allocation fails
+        prefixes_.insert(prefixes_.begin() + i, prefix);
+        try {
+            entries_.emplace(entries_.begin() + i, std::string(key), nullptr);
+        } catch (...) {
+            prefixes_.erase(prefixes_.begin() + i);
+            throw;
+        }
+    }
+    return entries_[i].second;
+}
+
+void BencodeDict::insert(std::string key, std::shared_ptr<BencodeValue> value) {
+    if (entries_.empty() || entries_.back().first < key) {
+        prefixes_.push_back(keyPrefix(key));
+        try {
+            entries_.emplace_back(std::move(key), std::move(value));
+        } catch (...) {
+            prefixes_.pop_back();
+            throw;
+        }
+        return;
+    }
+    (*this)[key] = std::move(value);
+}
+
+BencodeDict BencodeDict::fromEntries(std::vector<value_type> entries) {
+    auto less = [](const value_type& a, const value_type& b) { return a.first < b.first; };
+    if (!std::is_sorted(entries.begin(), entries.end(), less)) {
+        std::stable_sort(entries.begin(), entries.end(), less);
+    }
+    
+    // Stable sorting keeps duplicates in input order, so keep the last of each run
+    size_t out = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (out > 0 && entries[out - 1].first == entries[i].first) {
+            entries[out - 1] = std::move(entries[i]);
+        } else {
+            if (out != i) {
+                entries[out] = std::move(entries[i]);
+            }
+            out++;
+        }
+    }
+    entries.resize(out);
+    
+    BencodeDict result;
+    result.entries_ = std::move(entries);
+    result.prefixes_.reserve(result.entries_.size());
+    for (const auto& entry : result.entries_) {
+        result.prefixes_.push_back(keyPrefix(entry.first));
+    }
+    return result;
+}
+
 std::string BencodeValue::encode() const {
     if (isInteger()) {
         return "i" + std::to_string(asInteger()) + "e";
@@ -31,112 +139,209 @@ std::string BencodeValue::encode() const {
     throw std::runtime_error("Invalid bencode value type");
 }
 
-std::shared_ptr<BencodeValue> BencodeParser::parse(const std::string& data) {
-    size_t pos = 0;
-    return parseValue(data, pos);
+namespace {
+
+// Accumulates decimal digits starting at pos into value, stopping at the
+// first non-digit. Returns false if the value exceeds max.
+bool decodeDigits(const std::string& data, size_t& pos, uint64_t max, uint64_t& value) {
+    value = 0;
+    const size_t size = data.size();
+    while (pos < size) {
+        unsigned digit = static_cast<unsigned char>(data[pos]) - '0';
+        if (digit > 9) {
+            break;
+        }
+        if (value > (max - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+        pos++;
+    }
+    return true;
+}
+
+} // namespace
+
+std::shared_ptr<BencodeValue> BencodeParser::parse(const std::string& data, const ParseLimits& limits) {
+    if (data.length() > limits.max_size) {
+        throw std::runtime_error("Bencode data exceeds size limit");
+    }
+    
+    ParseState state{data, limits, 0, 0, 0};
+    auto value = parseValue(state);
+    if (limits.strict && state.pos != data.length()) {
+        throw std::runtime_error("Trailing data after bencode value");
+    }
+    return value;
 }
 
-std::shared_ptr<BencodeValue> BencodeParser::parseFile(const std::string& filename) {
-    std::ifstream file(filename, std::ios::binary);
+std::shared_ptr<BencodeValue> BencodeParser::parseFile(const std::string& filename, const ParseLimits& limits) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
     if (!file) {
         throw std::runtime_error("Failed to open file: " + filename);
     }
     
-    std::string data((std::istreambuf_iterator<char>(file)),
-                     std::istreambuf_iterator<char>());
-    return parse(data);
+    std::streamoff size = file.tellg();
+    if (size < 0 || static_cast<uint64_t>(size) > limits.max_size) {
+        throw std::runtime_error("File exceeds bencode size limit: " + filename);
+    }
+    file.seekg(0);
+    
+    std::string data(static_cast<size_t>(size), '\0');
+    file.read(data.data(), size);
+    if (file.gcount() != size) {
+        throw std::runtime_error("Failed to read file: " + filename);
+    }
+    return parse(data, limits);
 }
 
-std::shared_ptr<BencodeValue> BencodeParser::parseValue(const std::string& data, size_t& pos) {
-    if (pos >= data.length()) {
+std::shared_ptr<BencodeValue> BencodeParser::parseValue(ParseState& state) {
+    if (state.pos >= state.data.length()) {
         throw std::runtime_error("Unexpected end of data");
     }
+    if (++state.nodes > state.limits.max_nodes) {
+        throw std::runtime_error("Bencode data exceeds node limit");
+    }
     
-    char c = data[pos];
+    char c = state.data[state.pos];
     switch (c) {
-        case 'i': return std::make_shared<BencodeValue>(parseInteger(data, pos));
-        case 'l': return std::make_shared<BencodeValue>(parseList(data, pos));
-        case 'd': return std::make_shared<BencodeValue>(parseDict(data, pos));
+        case 'i': return std::make_shared<BencodeValue>(parseInteger(state));
+        case 'l': return std::make_shared<BencodeValue>(parseList(state));
+        case 'd': return std::make_shared<BencodeValue>(parseDict(state));
         default:
-            if (std::isdigit(c)) {
-                return std::make_shared<BencodeValue>(parseString(data, pos));
+            if (c >= '0' && c <= '9') {
+                return std::make_shared<BencodeValue>(parseString(state));
             }
             throw std::runtime_error("Invalid bencode format");
     }
 }
 
-BencodeInteger BencodeParser::parseInteger(const std::string& data, size_t& pos) {
-    if (data[pos] != 'i') {
+BencodeInteger BencodeParser::parseInteger(ParseState& state) {
+    const std::string& data = state.data;
+    if (data[state.pos] != 'i') {
         throw std::runtime_error("Expected 'i' for integer");
     }
-    pos++; // Skip 'i'
+    state.pos++; // Skip 'i'
+    
+    bool negative = state.pos < data.length() && data[state.pos] == '-';
+    state.pos += negative;
     
-    size_t end = data.find('e', pos);
-    if (end == std::string::npos) {
+    size_t digits_start = state.pos;
+    uint64_t max = static_cast<uint64_t>(std::numeric_limits<BencodeInteger>::max()) + negative;
+    uint64_t magnitude;
+    if (!decodeDigits(data, state.pos, max, magnitude)) {
+        throw std::runtime_error("Integer out of range");
+    }
+    
+    size_t digits = state.pos - digits_start;
+    if (digits == 0) {
+        throw std::runtime_error("Integer has no digits");
+    }
+    if (state.pos >= data.length() || data[state.pos] != 'e') {
         throw std::runtime_error("Missing 'e' for integer");
     }
+    if (state.limits.strict) {
+        if (digits > 1 && data[digits_start] == '0') {
+            throw std::runtime_error("Integer has leading zeros");
+        }
+        if (negative && magnitude == 0) {
+            throw std::runtime_error("Negative zero integer");
+        }
+    }
+    state.pos++; // Skip 'e'
     
-    BencodeInteger value = std::stoll(data.substr(pos, end - pos));
-    pos = end + 1; // Skip 'e'
-    return value;
+    // Negate in unsigned arithmetic so INT64_MIN does not overflow
+    return negative ? static_cast<BencodeInteger>(0 - magnitude) : static_cast<BencodeInteger>(magnitude);
 }
 
-BencodeString BencodeParser::parseString(const std::string& data, size_t& pos) {
-    size_t colon = data.find(':', pos);
-    if (colon == std::string::npos) {
-        throw std::runtime_error("Missing ':' in string");
+size_t BencodeParser::parseLength(ParseState& state) {
+    const std::string& data = state.data;
+    size_t digits_start = state.pos;
+    uint64_t length;
+    if (!decodeDigits(data, state.pos, data.length(), length)) {
+        throw std::runtime_error("String length exceeds data length");
     }
     
-    size_t length = std::stoul(data.substr(pos, colon - pos));
-    pos = colon + 1;
+    if (state.pos == digits_start) {
+        throw std::runtime_error("String length has no digits");
+    }
+    if (state.pos >= data.length() || data[state.pos] != ':') {
+        throw std::runtime_error("Missing ':' in string");
+    }
+    if (state.limits.strict && state.pos - digits_start > 1 && data[digits_start] == '0') {
+        throw std::runtime_error("String length has leading zeros");
+    }
+    state.pos++; // Skip ':'
     
-    if (pos + length > data.length()) {
+    if (length > data.length() - state.pos) {
         throw std::runtime_error("String length exceeds data length");
     }
-    
-    BencodeString result = data.substr(pos, length);
-    pos += length;
+    return static_cast<size_t>(length);
+}
+
+BencodeString BencodeParser::parseString(ParseState& state) {
+    size_t length = parseLength(state);
+    BencodeString result = state.data.substr(state.pos, length);
+    state.pos += length;
     return result;
 }
 
-BencodeList BencodeParser::parseList(const std::string& data, size_t& pos) {
-    if (data[pos] != 'l') {
+BencodeList BencodeParser::parseList(ParseState& state) {
+    const std::string& data = state.data;
+    if (data[state.pos] != 'l') {
         throw std::runtime_error("Expected 'l' for list");
     }
-    pos++; // Skip 'l'
+    if (++state.depth > state.limits.max_depth) {
+        throw std::runtime_error("Bencode nesting exceeds depth limit");
+    }
+    state.pos++; // Skip 'l'
     
     BencodeList result;
-    while (pos < data.length() && data[pos] != 'e') {
-        result.push_back(parseValue(data, pos));
+    while (state.pos < data.length() && data[state.pos] != 'e') {
+        result.push_back(parseValue(state));
     }
     
-    if (pos >= data.length() || data[pos] != 'e') {
+    if (state.pos >= data.length()) {
         throw std::runtime_error("Missing 'e' for list");
     }
-    pos++; // Skip 'e'
+    state.pos++; // Skip 'e'
+    state.depth--;
     
     return result;
 }
 
-BencodeDict BencodeParser::parseDict(const std::string& data, size_t& pos) {
-    if (data[pos] != 'd') {
+BencodeDict BencodeParser::parseDict(ParseState& state) {
+    const std::string& data = state.data;
+    if (data[state.pos] != 'd') {
         throw std::runtime_error("Expected 'd' for dictionary");
     }
-    pos++; // Skip 'd'
+    if (++state.depth > state.limits.max_depth) {
+        throw std::runtime_error("Bencode nesting exceeds depth limit");
+    }
+    state.pos++; // Skip 'd'
     
-    BencodeDict result;
-    while (pos < data.length() && data[pos] != 'e') {
-        BencodeString key = parseString(data, pos);
-        auto value = parseValue(data, pos);
-        result[key] = value;
+    // Entries are collected as they come and sorted once at the end, so
+    // unsorted input from lenient peers does not cost a shift per key
+    std::vector<BencodeDict::value_type> entries;
+    while (state.pos < data.length() && data[state.pos] != 'e') {
+        if (data[state.pos] < '0' || data[state.pos] > '9') {
+            throw std::runtime_error("Dictionary key must be a string");
+        }
+        BencodeString key = parseString(state);
+        if (state.limits.strict && !entries.empty() && !(entries.back().first < key)) {
+            throw std::runtime_error("Dictionary keys not sorted or duplicated");
+        }
+        auto value = parseValue(state);
+        entries.emplace_back(std::move(key), std::move(value));
     }
     
-    if (pos >= data.length() || data[pos] != 'e') {
+    if (state.pos >= data.length()) {
         throw std::runtime_error("Missing 'e' for dictionary");
     }
-    pos++; // Skip 'e'
+    state.pos++; // Skip 'e'
+    state.depth--;
     
-    return result;
+    return BencodeDict::fromEntries(std::move(entries));
 }
 
-} // namespace bencode 
\ No newline at end of file
+} // namespace bencode
\ No newline at end of file
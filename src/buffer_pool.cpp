@@ -0,0 +1,301 @@
+#include "buffer_pool.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t SLAB_ALIGNMENT = 4096;
+constexpr size_t THREAD_CACHE_SIZE = 32;
+
+} // namespace
+
+// Free blocks of one pool kept by a thread. A thread only caches for the
+// pool it used first; blocks of other pools go straight back. The pool keeps
+// a reference as well, so blocks left behind by an exiting thread can still
+// be reclaimed. The lock is only contended while the pool steals blocks.
+struct BufferPoolThreadCache {
+    std::mutex mutex;
+    std::atomic<BufferPool*> pool;  // Cleared when the pool is destroyed
+    std::vector<detail::PoolBlock*> blocks;
+    
+    explicit BufferPoolThreadCache(BufferPool* owner) : pool(owner) {}
+};
+
+namespace {
+
+thread_local std::shared_ptr<BufferPoolThreadCache> thread_cache;
+
+} // namespace
+
+BufferHandle::BufferHandle(const BufferHandle& other) : block_(other.block_) {
+    if (block_) {
+        block_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+BufferHandle::BufferHandle(BufferHandle&& other) noexcept : block_(other.block_) {
+    other.block_ = nullptr;
+}
+
+BufferHandle& BufferHandle::operator=(BufferHandle other) noexcept {
+    std::swap(block_, other.block_);
+    return *this;
+}
+
+BufferHandle::~BufferHandle() {
+    release();
+}
+
+void BufferHandle::release() {
+    if (block_ && block_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        block_->pool->release(block_);
+    }
+    block_ = nullptr;
+}
+
+size_t BufferHandle::capacity() const {
+    return block_->pool->getBlockSize();
+}
+
+void BufferHandle::resize(size_t length) {
+    if (length > capacity()) {
+        throw std::length_error("Buffer length exceeds block size");
+    }
+    block_->length = length;
+}
+
+BufferPool::BufferPool(size_t block_size, size_t max_blocks, size_t blocks_per_slab)
+    : block_size_(block_size),
+      max_blocks_(max_blocks),
+      blocks_per_slab_(std::max<size_t>(1, std::min(blocks_per_slab, max_blocks))) {
+    if (block_size_ == 0 || max_blocks_ == 0) {
+        throw std::invalid_argument("Buffer pool needs a non-zero block size and cap");
+    }
+}
+
+BufferPool::~BufferPool() {
+    // Threads may outlive the pool; their caches must not hand out its blocks
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& cache : caches_) {
+        std::lock_guard<std::mutex> cache_lock(cache->mutex);
+        cache->pool = nullptr;
+        cache->blocks.clear();
+    }
+}
+
+void BufferPool::allocateSlab() {
+    // The last slab is cut short so the cap is never exceeded
+    size_t count = std::min(blocks_per_slab_, max_blocks_ - blocks_allocated_);
+    size_t bytes = block_size_ * count;
+    bytes = (bytes + SLAB_ALIGNMENT - 1) / SLAB_ALIGNMENT * SLAB_ALIGNMENT;
+    
+    void* memory = std::aligned_alloc(SLAB_ALIGNMENT, bytes);
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+    
+    Slab slab{
+        std::unique_ptr<char, void (*)(void*)>(static_cast<char*>(memory), std::free),
+        std::make_unique<detail::PoolBlock[]>(count),
+        count
+    };
+    for (size_t i = 0; i < slab.count; ++i) {
+        slab.blocks[i].data = slab.memory.get() + i * block_size_;
+        slab.blocks[i].pool = this;
+        free_.push_back(&slab.blocks[i]);
+    }
+    slabs_.push_back(std::move(slab));
+    blocks_allocated_ += count;
+    slab_allocations_++;
+}
+
+void BufferPool::stealCachedBlocks() {
+    for (auto it = caches_.begin(); it != caches_.end();) {
+        {
+            std::lock_guard<std::mutex> cache_lock((*it)->mutex);
+            free_.insert(free_.end(), (*it)->blocks.begin(), (*it)->blocks.end());
+            (*it)->blocks.clear();
+        }
+        // Drop caches of threads that have exited
+        if (it->use_count() == 1) {
+            it = caches_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    cache_steals_++;
+}
+
+void BufferPool::reserve(size_t blocks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    blocks = std::min(blocks, max_blocks_);
+    while (blocks_allocated_ < blocks) {
+        allocateSlab();
+    }
+}
+
+bool BufferPool::reserveSlot() {
+    size_t current = in_use_.load(std::memory_order_relaxed);
+    do {
+        if (current >= max_blocks_) {
+            return false;
+        }
+    } while (!in_use_.compare_exchange_weak(current, current + 1));
+    
+    size_t peak = peak_in_use_.load(std::memory_order_relaxed);
+    while (current + 1 > peak &&
+           !peak_in_use_.compare_exchange_weak(peak, current + 1, std::memory_order_relaxed)) {
+    }
+    return true;
+}
+
+detail::PoolBlock* BufferPool::takeBlock() {
+    BufferPoolThreadCache* cache = thread_cache && thread_cache->pool == this ? thread_cache.get() : nullptr;
+    if (cache) {
+        std::lock_guard<std::mutex> cache_lock(cache->mutex);
+        if (!cache->blocks.empty()) {
+            detail::PoolBlock* block = cache->blocks.back();
+            cache->blocks.pop_back();
+            return block;
+        }
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.empty()) {
+        if (blocks_allocated_ < max_blocks_) {
+            allocateSlab();
+        } else {
+            // A slot was reserved, so with every block allocated at least one
+            // is sitting in a thread cache
+            stealCachedBlocks();
+        }
+        if (free_.empty()) {
+            throw std::logic_error("Buffer pool lost track of a block");
+        }
+    }
+    detail::PoolBlock* block = free_.back();
+    free_.pop_back();
+    
+    // Refill half of the thread cache while the lock is held anyway
+    if (cache) {
+        std::lock_guard<std::mutex> cache_lock(cache->mutex);
+        size_t refill = std::min(free_.size(), THREAD_CACHE_SIZE / 2 - std::min(cache->blocks.size(), THREAD_CACHE_SIZE / 2));
+        cache->blocks.insert(cache->blocks.end(), free_.end() - refill, free_.end());
+        free_.resize(free_.size() - refill);
+    }
+    return block;
+}
+
+BufferHandle BufferPool::makeHandle(detail::PoolBlock* block) {
+    block->refs.store(1, std::memory_order_relaxed);
+    block->length = 0;
+    acquires_.fetch_add(1, std::memory_order_relaxed);
+    return BufferHandle(block);
+}
+
+BufferPoolThreadCache* BufferPool::adoptThreadCache() {
+    if (thread_cache) {
+        std::lock_guard<std::mutex> cache_lock(thread_cache->mutex);
+        if (thread_cache->pool == this) {
+            return thread_cache.get();
+        }
+        if (thread_cache->pool) {
+            return nullptr;
+        }
+    }
+    
+    // First pool used by this thread, or the previous one is gone
+    thread_cache = std::make_shared<BufferPoolThreadCache>(this);
+    std::lock_guard<std::mutex> lock(mutex_);
+    caches_.push_back(thread_cache);
+    return thread_cache.get();
+}
+
+std::optional<BufferHandle> BufferPool::tryAcquire() {
+    adoptThreadCache();
+    if (!reserveSlot()) {
+        return std::nullopt;
+    }
+    return makeHandle(takeBlock());
+}
+
+std::optional<BufferHandle> BufferPool::acquireFor(std::chrono::steady_clock::duration timeout) {
+    if (auto handle = tryAcquire()) {
+        return handle;
+    }
+    
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        backpressure_waits_++;
+        waiters_++;
+        bool reserved = available_cv_.wait_for(lock, timeout, [this] { return reserveSlot(); });
+        waiters_--;
+        if (!reserved) {
+            return std::nullopt;
+        }
+    }
+    return makeHandle(takeBlock());
+}
+
+BufferHandle BufferPool::acquire() {
+    if (auto handle = tryAcquire()) {
+        return std::move(*handle);
+    }
+    
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        backpressure_waits_++;
+        waiters_++;
+        available_cv_.wait(lock, [this] { return reserveSlot(); });
+        waiters_--;
+    }
+    return makeHandle(takeBlock());
+}
+
+void BufferPool::release(detail::PoolBlock* block) {
+    bool cached = false;
+    if (thread_cache && thread_cache->pool == this) {
+        std::lock_guard<std::mutex> cache_lock(thread_cache->mutex);
+        if (thread_cache->blocks.size() < THREAD_CACHE_SIZE) {
+            thread_cache->blocks.push_back(block);
+            cached = true;
+        }
+    }
+    if (!cached) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(block);
+    }
+    // Only free the slot once the block can be found again
+    in_use_.fetch_sub(1);
+    
+    // Waiters sleep on the pool lock; only take it when someone is there
+    if (waiters_.load() > 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        available_cv_.notify_one();
+    }
+}
+
+std::vector<iovec> BufferPool::getSlabs() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<iovec> result;
+    result.reserve(slabs_.size());
+    for (const auto& slab : slabs_) {
+        result.push_back({slab.memory.get(), block_size_ * slab.count});
+    }
+    return result;
+}
+
+BufferPoolStats BufferPool::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {
+        slab_allocations_,
+        blocks_allocated_,
+        in_use_.load(),
+        peak_in_use_.load(),
+        acquires_.load(),
+        backpressure_waits_,
+        cache_steals_
+    };
+}
@@ -0,0 +1,195 @@
+#include "disk_io.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "io_uring.hpp"
+
+namespace {
+
+std::string errnoMessage(const std::string& what, int err) {
+    return what + ": " + std::strerror(err);
+}
+
+} // namespace
+
+void PosixDiskBackend::submit(const std::vector<DiskRequest>& requests) {
+    for (const auto& request : requests) {
+        size_t done = 0;
+        while (done < request.length) {
+            ssize_t n;
+            if (request.op == DiskOp::READ) {
+                n = ::pread(request.fd, request.buffer + done, request.length - done,
+                            static_cast<off_t>(request.offset + done));
+            } else {
+                n = ::pwrite(request.fd, request.buffer + done, request.length - done,
+                             static_cast<off_t>(request.offset + done));
+            }
+            syscalls_.fetch_add(1, std::memory_order_relaxed);
+            
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(errnoMessage("Disk I/O failed", errno));
+            }
+            if (n == 0) {
+                throw std::runtime_error("Unexpected end of file during disk read");
+            }
+            done += static_cast<size_t>(n);
+        }
+        requests_.fetch_add(1, std::memory_order_relaxed);
+        bytes_.fetch_add(request.length, std::memory_order_relaxed);
+    }
+}
+
+#ifdef BITTORRENT_HAVE_IO_URING
+
+namespace {
+
+// Batches go to the kernel in as few io_uring_enter calls as the ring allows
+class IoUringDiskBackend : public DiskBackend {
+public:
+    explicit IoUringDiskBackend(std::unique_ptr<IoUring> ring) : ring_(std::move(ring)) {}
+    
+    void submit(const std::vector<DiskRequest>& requests) override;
+    void registerBuffers(const std::vector<iovec>& buffers) override;
+    std::string name() const override { return "io_uring"; }
+    
+private:
+    void prepare(const DiskRequest& request, size_t done, uint64_t user_data);
+    int enter(unsigned to_submit, unsigned min_complete);
+    
+    std::unique_ptr<IoUring> ring_;
+    // One batch owns the ring at a time
+    std::mutex mutex_;
+    bool broken_ = false;  // Completions could not be reaped after an error
+};
+
+void IoUringDiskBackend::registerBuffers(const std::vector<iovec>& buffers) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ring_->registerBuffers(buffers);
+}
+
+void IoUringDiskBackend::prepare(const DiskRequest& request, size_t done, uint64_t user_data) {
+    io_uring_sqe* sqe = ring_->prepare();
+    
+    char* buffer = request.buffer + done;
+    size_t length = request.length - done;
+    int buf_index = ring_->findRegisteredBuffer(buffer, length);
+    
+    bool read = request.op == DiskOp::READ;
+    if (buf_index >= 0) {
+        sqe->opcode = read ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+        sqe->buf_index = static_cast<uint16_t>(buf_index);
+    } else {
+        sqe->opcode = read ? IORING_OP_READ : IORING_OP_WRITE;
+    }
+    sqe->fd = request.fd;
+    sqe->off = request.offset + done;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = static_cast<uint32_t>(length);
+    sqe->user_data = user_data;
+}
+
+int IoUringDiskBackend::enter(unsigned to_submit, unsigned min_complete) {
+    syscalls_.fetch_add(1, std::memory_order_relaxed);
+    return ring_->enter(to_submit, min_complete);
+}
+
+void IoUringDiskBackend::submit(const std::vector<DiskRequest>& requests) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (broken_) {
+        throw std::runtime_error("io_uring disk backend unusable after an earlier failure");
+    }
+    
+    std::vector<size_t> done(requests.size(), 0);
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        if (requests[i].length > 0) {
+            pending.push_back(i);
+        }
+    }
+    
+    while (!pending.empty()) {
+        // Submit as much as fits in the ring in one io_uring_enter call
+        size_t batch = std::min<size_t>(pending.size(), ring_->getEntries());
+        for (size_t i = 0; i < batch; ++i) {
+            size_t id = pending[i];
+            prepare(requests[id], done[id], id);
+        }
+        
+        unsigned submitted = 0;
+        unsigned completed = 0;
+        std::string error;
+        while (completed < batch) {
+            unsigned to_submit = static_cast<unsigned>(batch) - submitted;
+            int ret = enter(to_submit, static_cast<unsigned>(batch) - completed);
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                int err = errno;
+                // Take back entries the kernel never consumed, then wait out
+                // the ones it did
+                ring_->discardUnsubmitted();
+                if (!ring_->drain(submitted - completed)) {
+                    broken_ = true;
+                }
+                throw std::runtime_error(errnoMessage("io_uring_enter failed", err));
+            }
+            submitted += static_cast<unsigned>(ret);
+            
+            completed += ring_->reap([&](const io_uring_cqe& cqe) {
+                size_t id = static_cast<size_t>(cqe.user_data);
+                if (cqe.res < 0) {
+                    error = errnoMessage("Disk I/O failed", -cqe.res);
+                } else if (cqe.res == 0) {
+                    error = "Unexpected end of file during disk read";
+                } else {
+                    done[id] += static_cast<size_t>(cqe.res);
+                }
+            });
+        }
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+        
+        // Requeue short transfers behind whatever did not fit in this batch
+        std::vector<size_t> next(pending.begin() + batch, pending.end());
+        for (size_t i = 0; i < batch; ++i) {
+            size_t id = pending[i];
+            if (done[id] < requests[id].length) {
+                next.push_back(id);
+            }
+        }
+        pending.swap(next);
+    }
+    
+    requests_.fetch_add(requests.size(), std::memory_order_relaxed);
+    for (const auto& request : requests) {
+        bytes_.fetch_add(request.length, std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+#endif
+
+std::unique_ptr<DiskBackend> createDiskBackend(bool prefer_io_uring) {
+#ifdef BITTORRENT_HAVE_IO_URING
+    if (prefer_io_uring) {
+        if (auto ring = IoUring::create(256)) {
+            return std::make_unique<IoUringDiskBackend>(std::move(ring));
+        }
+        Logger::info("io_uring not supported by this kernel, using portable disk I/O");
+    }
+#else
+    (void)prefer_io_uring;
+#endif
+    return std::make_unique<PosixDiskBackend>();
+}
@@ -0,0 +1,121 @@
+#include "file_selection.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+FileSelection::FileSelection(const TorrentFile& torrent)
+    : torrent_(torrent),
+      file_priorities_(torrent.getInfo().files.size(), DownloadPriority::NORMAL),
+      piece_priorities_(torrent.getNumPieces(), DownloadPriority::NORMAL),
+      wanted_bytes_(torrent.getInfo().total_length) {}
+
+void FileSelection::setPriority(size_t file_index, DownloadPriority priority) {
+    if (file_index >= file_priorities_.size()) {
+        throw std::out_of_range("File index out of range");
+    }
+    
+    DownloadPriority old_priority = file_priorities_[file_index];
+    if (old_priority == priority) {
+        return;
+    }
+    
+    uint64_t length = torrent_.getInfo().files[file_index].length;
+    if (old_priority == DownloadPriority::SKIP) {
+        wanted_bytes_ += length;
+    } else if (priority == DownloadPriority::SKIP) {
+        wanted_bytes_ -= length;
+    }
+    
+    file_priorities_[file_index] = priority;
+    updatePieces(file_index);
+}
+
+void FileSelection::setPriorities(const std::vector<DownloadPriority>& priorities) {
+    if (priorities.size() != file_priorities_.size()) {
+        throw std::invalid_argument("Priority count does not match file count");
+    }
+    for (size_t i = 0; i < priorities.size(); ++i) {
+        setPriority(i, priorities[i]);
+    }
+}
+
+DownloadPriority FileSelection::getPriority(size_t file_index) const {
+    if (file_index >= file_priorities_.size()) {
+        throw std::out_of_range("File index out of range");
+    }
+    return file_priorities_[file_index];
+}
+
+bool FileSelection::isWanted(size_t file_index) const {
+    return getPriority(file_index) != DownloadPriority::SKIP;
+}
+
+DownloadPriority FileSelection::getPiecePriority(size_t piece) const {
+    if (piece >= piece_priorities_.size()) {
+        throw std::out_of_range("Piece index out of range");
+    }
+    return piece_priorities_[piece];
+}
+
+std::pair<size_t, size_t> FileSelection::getFilesInPiece(size_t piece) const {
+    uint64_t start = static_cast<uint64_t>(piece) * torrent_.getInfo().piece_length;
+    uint64_t end = start + torrent_.getPieceSize(piece);
+    
+    // Both ends are binary searches, so this stays O(log n) with many files
+    size_t first = torrent_.getFileIndexAt(start);
+    size_t last = torrent_.getFileIndexAt(end - 1) + 1;
+    return {first, last};
+}
+
+void FileSelection::updatePieces(size_t file_index) {
+    const auto& file = torrent_.getInfo().files[file_index];
+    PieceRange pieces = torrent_.getPieceRange(file_index, 0, file.length);
+    
+    for (size_t piece = pieces.first; piece < pieces.last; ++piece) {
+        // Only the first and last piece of a file can be shared with others
+        if (piece != pieces.first && piece + 1 != pieces.last) {
+            piece_priorities_[piece] = file_priorities_[file_index];
+            continue;
+        }
+        
+        auto [first, last] = getFilesInPiece(piece);
+        DownloadPriority priority = DownloadPriority::SKIP;
+        for (size_t i = first; i < last; ++i) {
+            if (torrent_.getInfo().files[i].length > 0) {
+                priority = std::max(priority, file_priorities_[i]);
+            }
+        }
+        piece_priorities_[piece] = priority;
+    }
+}
+
+uint64_t FileSelection::getBytesLeft(const PiecePicker& picker) const {
+    const auto& info = torrent_.getInfo();
+    uint64_t left = 0;
+    
+    for (size_t piece = 0; piece < piece_priorities_.size(); ++piece) {
+        if (piece_priorities_[piece] == DownloadPriority::SKIP || picker.havePiece(piece)) {
+            continue;
+        }
+        
+        uint64_t start = static_cast<uint64_t>(piece) * info.piece_length;
+        uint64_t end = start + torrent_.getPieceSize(piece);
+        auto [first, last] = getFilesInPiece(piece);
+        for (size_t i = first; i < last; ++i) {
+            if (file_priorities_[i] == DownloadPriority::SKIP) {
+                continue;
+            }
+            uint64_t file_start = std::max<uint64_t>(start, info.files[i].offset);
+            uint64_t file_end = std::min<uint64_t>(end, info.files[i].offset + info.files[i].length);
+            if (file_end > file_start) {
+                left += file_end - file_start;
+            }
+        }
+    }
+    return left;
+}
+
+void FileSelection::apply(PiecePicker& picker) const {
+    for (size_t piece = 0; piece < piece_priorities_.size(); ++piece) {
+        picker.setPriority(piece, piece_priorities_[piece]);
+    }
+}
@@ -0,0 +1,96 @@
+#include "file_stream.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+FileStream::FileStream(const TorrentFile& torrent,
+                       PiecePicker& picker,
+                       PieceStorage& storage,
+                       size_t file_index)
+    : torrent_(torrent),
+      picker_(picker),
+      storage_(storage),
+      file_index_(file_index),
+      read_ahead_(4 * torrent.getInfo().piece_length),
+      deadline_step_(std::chrono::milliseconds(100)),
+      timeout_(std::chrono::seconds(30)),
+      opened_at_(PiecePicker::Clock::now()) {
+    const auto& info = torrent.getInfo();
+    if (file_index >= info.files.size()) {
+        throw std::out_of_range("File index out of range");
+    }
+    file_ = info.files[file_index];
+}
+
+FileStream::~FileStream() {
+    clearDeadlines();
+}
+
+void FileStream::seek(size_t offset) {
+    if (offset > file_.length) {
+        throw std::out_of_range("Seek past end of file");
+    }
+    // Deadlines from before the seek are older than the ones the next read
+    // sets and would be picked first
+    if (offset != position_) {
+        clearDeadlines();
+    }
+    position_ = offset;
+}
+
+void FileStream::clearDeadlines() {
+    for (size_t piece : deadline_pieces_) {
+        picker_.clearDeadline(piece);
+    }
+    deadline_pieces_.clear();
+}
+
+void FileStream::scheduleDeadlines(size_t offset, size_t length) {
+    auto now = PiecePicker::Clock::now();
+    
+    // Pieces needed for this read are due immediately
+    PieceRange needed = torrent_.getPieceRange(file_index_, offset, length);
+    for (size_t i = needed.first; i < needed.last; ++i) {
+        picker_.setDeadline(i, now);
+        deadline_pieces_.insert(i);
+    }
+    
+    // Read-ahead pieces get increasingly later deadlines
+    size_t ahead_offset = offset + length;
+    size_t ahead_length = std::min(read_ahead_, file_.length - ahead_offset);
+    PieceRange ahead = torrent_.getPieceRange(file_index_, ahead_offset, ahead_length);
+    auto deadline = now;
+    for (size_t i = std::max(ahead.first, needed.last); i < ahead.last; ++i) {
+        deadline += deadline_step_;
+        picker_.setDeadline(i, deadline);
+        deadline_pieces_.insert(i);
+    }
+}
+
+size_t FileStream::read(char* buffer, size_t length) {
+    length = std::min(length, file_.length - position_);
+    if (length == 0) {
+        return 0;
+    }
+    
+    scheduleDeadlines(position_, length);
+    
+    PieceRange needed = torrent_.getPieceRange(file_index_, position_, length);
+    if (!picker_.haveRange(needed)) {
+        stats_.stalls++;
+        if (!picker_.waitForRange(needed, timeout_)) {
+            throw std::runtime_error("Timed out waiting for pieces of " + file_.path);
+        }
+    }
+    
+    storage_.readFile(file_index_, position_, buffer, length);
+    
+    position_ += length;
+    stats_.reads++;
+    stats_.bytes_read += length;
+    if (!stats_.first_byte_served) {
+        stats_.first_byte_served = true;
+        stats_.time_to_first_byte = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            PiecePicker::Clock::now() - opened_at_);
+    }
+    return length;
+}
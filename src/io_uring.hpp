@@ -0,0 +1,81 @@
+#pragma once
+
+// Private to the library: only built when BITTORRENT_HAVE_IO_URING is set
+
+#ifdef BITTORRENT_HAVE_IO_URING
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+
+// Minimal io_uring driver on top of the raw syscalls, so no liburing is
+// needed. Not thread-safe; the backends built on it serialize access.
+class IoUring {
+public:
+    // Returns nullptr if the running kernel lacks what this driver needs
+    static std::unique_ptr<IoUring> create(unsigned entries);
+    ~IoUring();
+    
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+    
+    unsigned getEntries() const { return sq_entries_; }
+    bool supports(uint8_t opcode) const;
+    
+    // Zeroed entry at the tail of the submission queue, queued for the next enter
+    io_uring_sqe* prepare();
+    // Takes back prepared entries the kernel has not consumed yet
+    void discardUnsubmitted();
+    // io_uring_enter; returns -1 with errno set on failure
+    int enter(unsigned to_submit, unsigned min_complete);
+    
+    // Calls handler for each available completion and returns how many there were
+    template <typename Handler>
+    unsigned reap(Handler&& handler) {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        unsigned count = tail - head;
+        for (; head != tail; ++head) {
+            handler(cqes_[head & *cq_mask_]);
+        }
+        __atomic_store_n(cq_head_, tail, __ATOMIC_RELEASE);
+        return count;
+    }
+    
+    // Waits until in_flight requests have fully completed, counting a request
+    // that announced more completions (IORING_CQE_F_MORE) only at its last.
+    // Returns false if completions could not be reaped.
+    bool drain(unsigned in_flight);
+    
+    // Replaces the registered buffer set; false if the kernel refused it
+    bool registerBuffers(const std::vector<iovec>& buffers);
+    int findRegisteredBuffer(const char* buffer, size_t length) const;
+    
+private:
+    IoUring() = default;
+    bool setup(unsigned entries);
+    
+    int ring_fd_ = -1;
+    unsigned sq_entries_ = 0;
+    std::vector<bool> supported_ops_;
+    
+    void* ring_ptr_ = nullptr;
+    size_t ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+    
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    
+    std::vector<iovec> registered_;
+};
+
+#endif
@@ -0,0 +1,168 @@
+#include "local_discovery.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cctype>
+#include <random>
+#include <sstream>
+
+namespace {
+
+std::string trim(const std::string& str) {
+    size_t start = str.find_first_not_of(" \t\r");
+    if (start == std::string::npos) {
+        return "";
+    }
+    size_t end = str.find_last_not_of(" \t\r");
+    return str.substr(start, end - start + 1);
+}
+
+std::string toLower(std::string str) {
+    std::transform(str.begin(), str.end(), str.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return str;
+}
+
+} // namespace
+
+LocalServiceDiscovery::LocalServiceDiscovery(boost::asio::io_context& io,
+                                             uint16_t listen_port,
+                                             PeerHandler handler,
+                                             const std::string& multicast_address,
+                                             uint16_t multicast_port)
+    : socket_(io),
+      retry_timer_(io),
+      multicast_endpoint_(boost::asio::ip::make_address(multicast_address), multicast_port),
+      listen_port_(listen_port),
+      handler_(std::move(handler)) {
+    using boost::asio::ip::udp;
+    
+    // Several clients on one host must be able to share the LSD port
+    socket_.open(udp::v4());
+    socket_.set_option(udp::socket::reuse_address(true));
+    socket_.bind(udp::endpoint(boost::asio::ip::address_v4::any(), multicast_port));
+    socket_.set_option(boost::asio::ip::multicast::join_group(multicast_endpoint_.address()));
+    socket_.set_option(boost::asio::ip::multicast::enable_loopback(true));
+    socket_.set_option(boost::asio::ip::multicast::hops(1));
+    
+    // Lets us drop our own announces when they loop back
+    std::random_device rd;
+    std::stringstream ss;
+    ss << std::hex << rd() << rd();
+    cookie_ = ss.str();
+    
+    startReceive();
+}
+
+std::string LocalServiceDiscovery::buildAnnounce(const std::string& host,
+                                                 uint16_t port,
+                                                 const std::vector<std::string>& info_hashes,
+                                                 const std::string& cookie) {
+    std::stringstream ss;
+    ss << "BT-SEARCH * HTTP/1.1\r\n"
+       << "Host: " << host << "\r\n"
+       << "Port: " << port << "\r\n";
+    for (const auto& info_hash : info_hashes) {
+        ss << "Infohash: " << info_hash << "\r\n";
+    }
+    if (!cookie.empty()) {
+        ss << "cookie: " << cookie << "\r\n";
+    }
+    ss << "\r\n\r\n";
+    return ss.str();
+}
+
+std::optional<LsdAnnounce> LocalServiceDiscovery::parseAnnounce(const std::string& message) {
+    std::istringstream stream(message);
+    std::string line;
+    if (!std::getline(stream, line) || trim(line).rfind("BT-SEARCH * HTTP/1.1", 0) != 0) {
+        return std::nullopt;
+    }
+    
+    LsdAnnounce announce{0, {}, ""};
+    while (std::getline(stream, line)) {
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string name = toLower(trim(line.substr(0, colon)));
+        std::string value = trim(line.substr(colon + 1));
+        
+        if (name == "port") {
+            try {
+                unsigned long port = std::stoul(value);
+                if (port == 0 || port > 65535) {
+                    return std::nullopt;
+                }
+                announce.port = static_cast<uint16_t>(port);
+            } catch (const std::exception&) {
+                return std::nullopt;
+            }
+        } else if (name == "infohash") {
+            bool hex = std::all_of(value.begin(), value.end(),
+                                   [](unsigned char c) { return std::isxdigit(c) != 0; });
+            if (value.length() == 40 && hex) {
+                announce.info_hashes.push_back(toLower(value));
+            }
+        } else if (name == "cookie") {
+            announce.cookie = value;
+        }
+    }
+    
+    if (announce.port == 0 || announce.info_hashes.empty()) {
+        return std::nullopt;
+    }
+    return announce;
+}
+
+void LocalServiceDiscovery::announce(const std::vector<std::string>& info_hashes) {
+    std::string host = multicast_endpoint_.address().to_string() + ":" +
+                       std::to_string(multicast_endpoint_.port());
+    std::string message = buildAnnounce(host, listen_port_, info_hashes, cookie_);
+    
+    boost::system::error_code ec;
+    socket_.send_to(boost::asio::buffer(message), multicast_endpoint_, 0, ec);
+    if (ec) {
+        Logger::warning("Failed to send LSD announce: " + ec.message());
+    }
+}
+
+void LocalServiceDiscovery::close() {
+    boost::system::error_code ec;
+    socket_.close(ec);
+    retry_timer_.cancel();
+}
+
+void LocalServiceDiscovery::startReceive() {
+    socket_.async_receive_from(
+        boost::asio::buffer(buffer_), sender_,
+        [this](const boost::system::error_code& ec, size_t bytes) {
+            if (ec == boost::asio::error::operation_aborted) {
+                return;
+            }
+            if (!ec) {
+                handleMessage(std::string(buffer_.data(), bytes), sender_.address());
+                startReceive();
+                return;
+            }
+            
+            Logger::debug("LSD receive failed: " + ec.message());
+            retry_timer_.expires_after(RECEIVE_RETRY_DELAY);
+            retry_timer_.async_wait([this](const boost::system::error_code& timer_ec) {
+                if (!timer_ec && socket_.is_open()) {
+                    startReceive();
+                }
+            });
+        });
+}
+
+void LocalServiceDiscovery::handleMessage(const std::string& message, const boost::asio::ip::address& sender) {
+    auto announce = parseAnnounce(message);
+    if (!announce || announce->cookie == cookie_) {
+        return;
+    }
+    
+    Peer peer{sender.to_string(), announce->port};
+    for (const auto& info_hash : announce->info_hashes) {
+        handler_(info_hash, peer);
+    }
+}
@@ -1,8 +1,15 @@
 #include "torrent_file.hpp"
 #include "tracker_client.hpp"
+#include "peer_exchange.hpp"
+#include "local_discovery.hpp"
+#include "file_selection.hpp"
+#include "piece_picker.hpp"
+#include "piece_storage.hpp"
+#include "web_seed.hpp"
 #include "logger.hpp"
 #include <iostream>
 #include <iomanip>
+#include <optional>
 
 void printTorrentInfo(const TorrentFile& torrent) {
     std::cout << "Torrent Information:" << std::endl;
@@ -21,6 +28,13 @@ void printTorrentInfo(const TorrentFile& torrent) {
     for (const auto& url : torrent.getAnnounceUrls()) {
         std::cout << "- " << url << std::endl;
     }
+    
+    if (!torrent.getWebSeeds().empty()) {
+        std::cout << "\nWeb Seeds:" << std::endl;
+        for (const auto& url : torrent.getWebSeeds()) {
+            std::cout << "- " << url << std::endl;
+        }
+    }
 }
 
 void printTrackerResponse(const TrackerResponse& response) {
@@ -47,17 +61,83 @@ void printTrackerResponse(const TrackerResponse& response) {
     }
 }
 
+void discoverLocalPeers(const TorrentFile& torrent, PeerList& peer_list, uint16_t port) {
+    boost::asio::io_context io;
+    try {
+        LocalServiceDiscovery lsd(io, port, [&](const std::string& info_hash, const Peer& peer) {
+            if (info_hash == torrent.getInfoHash()) {
+                peer_list.add({peer});
+            }
+        });
+        lsd.announce({torrent.getInfoHash()});
+        io.run_for(std::chrono::seconds(2));
+    } catch (const boost::system::system_error& e) {
+        Logger::warning(std::string("Local service discovery unavailable: ") + e.what());
+    }
+}
+
+void downloadFromWebSeeds(const TorrentFile& torrent, PieceStorage& storage, PiecePicker& picker) {
+    WebSeedClient web_seeds(torrent, storage, picker, torrent.getWebSeeds());
+    size_t verified = web_seeds.run();
+    
+    const auto& stats = web_seeds.getStats();
+    std::cout << "\nWeb Seeds: " << verified << " pieces in " << stats.requests << " requests, "
+              << std::fixed << std::setprecision(1) << stats.megabytesPerSecond() << " MB/s";
+    if (stats.pieces_failed > 0) {
+        std::cout << " (" << stats.pieces_failed << " failed)";
+    }
+    std::cout << std::endl;
+}
+
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <torrent_file>" << std::endl;
+    // Local discovery binds a well-known port and listens for a while, so
+    // it only runs when asked for
+    bool use_lsd = false;
+    std::string download_dir = ".";
+    std::string torrent_path;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--lsd") {
+            use_lsd = true;
+        } else if (arg == "--verbose") {
+            Logger::setLevel(LogLevel::DEBUG);
+        } else if (arg == "--dir" && i + 1 < argc) {
+            download_dir = argv[++i];
+        } else if (torrent_path.empty() && arg.rfind("--", 0) != 0) {
+            torrent_path = arg;
+        } else {
+            torrent_path.clear();
+            break;
+        }
+    }
+    if (torrent_path.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--lsd] [--verbose] [--dir <download_dir>] <torrent_file>" << std::endl;
         return 1;
     }
     
     try {
         // Parse torrent file
-        TorrentFile torrent(argv[1]);
+        TorrentFile torrent(torrent_path);
         printTorrentInfo(torrent);
         
+        // All files are wanted until priorities are set
+        FileSelection selection(torrent);
+        PiecePicker picker(torrent.getNumPieces());
+        
+        // Only web seeds download anything so far, so the download directory
+        // is left untouched without them. Pieces left over from an earlier
+        // run need not be fetched again.
+        std::optional<PieceStorage> storage;
+        if (!torrent.getWebSeeds().empty()) {
+            storage.emplace(torrent, download_dir, &selection);
+            for (size_t piece = 0; piece < torrent.getNumPieces(); ++piece) {
+                if (storage->verifyPiece(piece)) {
+                    picker.markHave(piece);
+                }
+            }
+        }
+        selection.apply(picker);
+        
         // Create tracker client
         TrackerClient tracker;
         
@@ -67,22 +147,43 @@ int main(int argc, char* argv[]) {
             peer_id += static_cast<char>('0' + (rand() % 10));
         }
         
-        // Announce to tracker
-        TrackerResponse response = tracker.announce(
-            torrent.getAnnounceUrls()[0],  // Use first tracker
-            torrent.getInfoHash(),
-            peer_id,
-            6881,  // Default BitTorrent port
-            0,     // Uploaded bytes
-            0,     // Downloaded bytes
-            torrent.getInfo().total_length,  // Left to download
-            true,  // Use compact format
-            false, // Include peer ID
-            true,  // Include event
-            "started"  // Initial event
-        );
+        // Announce to tracker; a torrent with web seeds can do without one
+        PeerList peer_list;
+        if (!torrent.getAnnounceUrls().empty()) {
+            try {
+                TrackerResponse response = tracker.announce(
+                    torrent.getAnnounceUrls()[0],  // Use first tracker
+                    torrent.getInfoHash(),
+                    peer_id,
+                    6881,  // Default BitTorrent port
+                    0,     // Uploaded bytes
+                    0,     // Downloaded bytes
+                    selection.getBytesLeft(picker),  // Left to download
+                    true,  // Use compact format
+                    false, // Include peer ID
+                    true,  // Include event
+                    "started"  // Initial event
+                );
+                
+                printTrackerResponse(response);
+                peer_list.add(response.peers);
+            } catch (const std::exception& e) {
+                if (torrent.getWebSeeds().empty()) {
+                    throw;
+                }
+                Logger::warning(std::string("Tracker announce failed: ") + e.what());
+            }
+        }
         
-        printTrackerResponse(response);
+        // Collect peers from the local network as well
+        if (use_lsd) {
+            discoverLocalPeers(torrent, peer_list, 6881);
+        }
+        std::cout << "\nKnown Peers: " << peer_list.size() << std::endl;
+        
+        if (storage && selection.getBytesLeft(picker) > 0) {
+            downloadFromWebSeeds(torrent, *storage, picker);
+        }
         
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
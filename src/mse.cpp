@@ -0,0 +1,369 @@
+#include "mse.hpp"
+#include "socket_io.hpp"
+#include <openssl/bn.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+namespace mse {
+
+namespace {
+
+const char* PRIME_HEX =
+    "FFFFFFFFFFFFFFFFC90FDAA22168C234C4C6628B80DC1CD129024E088A67CC74"
+    "020BBEA63B139B22514A08798E3404DDEF9519B3CD3A431B302B0A6DF25F1437"
+    "4FE1356D6D51C245E485B576625E7EC6F44C42E9A63A36210000000000090563";
+
+constexpr unsigned long GENERATOR = 2;
+constexpr int PRIVATE_KEY_BITS = 160;
+
+using BignumPtr = std::unique_ptr<BIGNUM, decltype(&BN_free)>;
+using BnCtxPtr = std::unique_ptr<BN_CTX, decltype(&BN_CTX_free)>;
+
+BignumPtr makeBignum(BIGNUM* bn) {
+    if (!bn) {
+        throw std::runtime_error("Failed to allocate BIGNUM");
+    }
+    return BignumPtr(bn, BN_free);
+}
+
+BignumPtr prime() {
+    BIGNUM* p = nullptr;
+    if (!BN_hex2bn(&p, PRIME_HEX)) {
+        throw std::runtime_error("Failed to load MSE prime");
+    }
+    return makeBignum(p);
+}
+
+BignumPtr fromBytes(const std::string& bytes) {
+    return makeBignum(BN_bin2bn(reinterpret_cast<const unsigned char*>(bytes.data()),
+                                static_cast<int>(bytes.size()), nullptr));
+}
+
+std::string toBytes(const BIGNUM* bn) {
+    std::string result(KEY_SIZE, '\0');
+    if (BN_bn2binpad(bn, reinterpret_cast<unsigned char*>(result.data()), KEY_SIZE) != KEY_SIZE) {
+        throw std::runtime_error("DH value does not fit in 96 bytes");
+    }
+    return result;
+}
+
+// g^e mod P
+std::string modExp(const BIGNUM* base, const BIGNUM* exponent) {
+    BnCtxPtr ctx(BN_CTX_new(), BN_CTX_free);
+    auto p = prime();
+    auto result = makeBignum(BN_new());
+    if (!ctx || !BN_mod_exp(result.get(), base, exponent, p.get(), ctx.get())) {
+        throw std::runtime_error("DH modular exponentiation failed");
+    }
+    return toBytes(result.get());
+}
+
+std::string sha1(const std::string& data) {
+    unsigned char hash[SHA_DIGEST_LENGTH];
+    SHA1(reinterpret_cast<const unsigned char*>(data.data()), data.size(), hash);
+    return std::string(reinterpret_cast<char*>(hash), SHA_DIGEST_LENGTH);
+}
+
+std::string randomBytes(size_t length) {
+    std::string result(length, '\0');
+    if (length > 0 && RAND_bytes(reinterpret_cast<unsigned char*>(result.data()), static_cast<int>(length)) != 1) {
+        throw std::runtime_error("Failed to generate random bytes");
+    }
+    return result;
+}
+
+} // namespace
+
+const std::string& verificationConstant() {
+    static const std::string vc(8, '\0');
+    return vc;
+}
+
+std::string makePadding() {
+    std::string length_byte = randomBytes(2);
+    size_t length = ((static_cast<unsigned char>(length_byte[0]) << 8) |
+                     static_cast<unsigned char>(length_byte[1])) % (MAX_PADDING + 1);
+    return randomBytes(length);
+}
+
+Rc4Cipher::Rc4Cipher(const unsigned char* key, size_t length) {
+    if (length == 0) {
+        throw std::invalid_argument("RC4 key must not be empty");
+    }
+    for (size_t i = 0; i < state_.size(); ++i) {
+        state_[i] = static_cast<uint8_t>(i);
+    }
+    uint8_t j = 0;
+    for (size_t i = 0; i < state_.size(); ++i) {
+        j = static_cast<uint8_t>(j + state_[i] + key[i % length]);
+        std::swap(state_[i], state_[j]);
+    }
+}
+
+void Rc4Cipher::discard(size_t length) {
+    uint8_t i = i_;
+    uint8_t j = j_;
+    for (size_t n = 0; n < length; ++n) {
+        i = static_cast<uint8_t>(i + 1);
+        j = static_cast<uint8_t>(j + state_[i]);
+        std::swap(state_[i], state_[j]);
+    }
+    i_ = i;
+    j_ = j;
+}
+
+void Rc4Cipher::apply(char* data, size_t length) {
+    // Work on locals so the compiler keeps the indices in registers
+    uint8_t* s = state_.data();
+    uint8_t i = i_;
+    uint8_t j = j_;
+    unsigned char* bytes = reinterpret_cast<unsigned char*>(data);
+    for (size_t n = 0; n < length; ++n) {
+        i = static_cast<uint8_t>(i + 1);
+        uint8_t si = s[i];
+        j = static_cast<uint8_t>(j + si);
+        uint8_t sj = s[j];
+        s[i] = sj;
+        s[j] = si;
+        bytes[n] ^= s[static_cast<uint8_t>(si + sj)];
+    }
+    i_ = i;
+    j_ = j;
+}
+
+void Rc4Cipher::apply(const iovec* buffers, size_t count) {
+    for (size_t n = 0; n < count; ++n) {
+        apply(static_cast<char*>(buffers[n].iov_base), buffers[n].iov_len);
+    }
+}
+
+KeyExchange::KeyExchange() {
+    auto x = makeBignum(BN_new());
+    if (!BN_rand(x.get(), PRIVATE_KEY_BITS, BN_RAND_TOP_ANY, BN_RAND_BOTTOM_ANY)) {
+        throw std::runtime_error("Failed to generate DH private key");
+    }
+    private_key_ = toBytes(x.get());
+    
+    auto g = makeBignum(BN_new());
+    BN_set_word(g.get(), GENERATOR);
+    public_key_ = modExp(g.get(), x.get());
+}
+
+std::string KeyExchange::computeSecret(const std::string& peer_public_key) const {
+    if (peer_public_key.size() != KEY_SIZE) {
+        throw std::runtime_error("Invalid MSE public key length");
+    }
+    
+    // Reject 0, 1 and P-1 and anything outside the group
+    auto y = fromBytes(peer_public_key);
+    auto p_minus_one = prime();
+    BN_sub_word(p_minus_one.get(), 1);
+    if (BN_cmp(y.get(), BN_value_one()) <= 0 || BN_cmp(y.get(), p_minus_one.get()) >= 0) {
+        throw std::runtime_error("Invalid MSE public key");
+    }
+    
+    auto x = fromBytes(private_key_);
+    return modExp(y.get(), x.get());
+}
+
+std::string req1Hash(const std::string& secret) {
+    return sha1("req1" + secret);
+}
+
+std::string req2Req3Hash(const std::string& secret, const std::string& skey) {
+    std::string req2 = sha1("req2" + skey);
+    std::string req3 = sha1("req3" + secret);
+    for (size_t i = 0; i < req2.size(); ++i) {
+        req2[i] ^= req3[i];
+    }
+    return req2;
+}
+
+namespace {
+
+Rc4Cipher makeCipher(const std::string& label, const std::string& secret, const std::string& skey) {
+    std::string key = sha1(label + secret + skey);
+    Rc4Cipher cipher(reinterpret_cast<const unsigned char*>(key.data()), key.size());
+    cipher.discard(RC4_DISCARD);
+    return cipher;
+}
+
+} // namespace
+
+CipherStream::CipherStream(const std::string& secret, const std::string& skey, bool initiator)
+    : send_(makeCipher(initiator ? "keyA" : "keyB", secret, skey)),
+      receive_(makeCipher(initiator ? "keyB" : "keyA", secret, skey)) {}
+
+namespace {
+
+constexpr size_t HASH_SIZE = 20;
+
+std::string uint16Bytes(size_t value) {
+    return {static_cast<char>(value >> 8), static_cast<char>(value)};
+}
+
+std::string uint32Bytes(uint32_t value) {
+    return {static_cast<char>(value >> 24), static_cast<char>(value >> 16),
+            static_cast<char>(value >> 8), static_cast<char>(value)};
+}
+
+size_t readUint16(const std::string& data, size_t offset) {
+    return (static_cast<size_t>(static_cast<unsigned char>(data[offset])) << 8) |
+           static_cast<unsigned char>(data[offset + 1]);
+}
+
+uint32_t readUint32(const std::string& data, size_t offset) {
+    return (static_cast<uint32_t>(readUint16(data, offset)) << 16) |
+           static_cast<uint32_t>(readUint16(data, offset + 2));
+}
+
+// Exact-length reads and writes on the handshake socket. Never reads past
+// the handshake, so the connection can go on to the payload stream.
+class HandshakeSocket {
+public:
+    explicit HandshakeSocket(int fd) : fd_(fd) {}
+    
+    void write(std::string data) {
+        io_.submit({{SocketOp::SEND, fd_, data.data(), data.size()}});
+    }
+    
+    std::string read(size_t length) {
+        std::string data(length, '\0');
+        if (length > 0) {
+            io_.submit({{SocketOp::RECV, fd_, data.data(), data.size()}});
+        }
+        return data;
+    }
+    
+    // Consumes the stream up to and including the first occurrence of
+    // marker, which must end within limit bytes
+    void scanFor(const std::string& marker, size_t limit) {
+        std::string window;
+        size_t partial = 0;
+        while (true) {
+            window += read(marker.size() - partial);
+            if (window.compare(window.size() - marker.size(), marker.size(), marker) == 0) {
+                return;
+            }
+            // A match can start no earlier than the longest tail of the
+            // window that begins the marker, so reading up to where that
+            // match would end never consumes bytes past the marker
+            partial = marker.size() - 1;
+            while (partial > 0 && window.compare(window.size() - partial, partial, marker, 0, partial) != 0) {
+                partial--;
+            }
+            if (window.size() + marker.size() - partial > limit) {
+                throw std::runtime_error("MSE handshake synchronisation failed");
+            }
+        }
+    }
+    
+private:
+    int fd_;
+    PosixSocketBackend io_;
+};
+
+size_t readPaddingLength(const std::string& data, size_t offset) {
+    size_t length = readUint16(data, offset);
+    if (length > MAX_PADDING) {
+        throw std::runtime_error("MSE padding too long");
+    }
+    return length;
+}
+
+} // namespace
+
+HandshakeResult initiateHandshake(int fd, const std::string& skey, uint32_t crypto_provide,
+                                  const std::string& initial_payload) {
+    if (initial_payload.size() > 0xFFFF) {
+        throw std::invalid_argument("MSE initial payload too long");
+    }
+    
+    HandshakeSocket socket(fd);
+    KeyExchange keys;
+    socket.write(keys.getPublicKey() + makePadding());
+    std::string secret = keys.computeSecret(socket.read(KEY_SIZE));
+    CipherStream cipher(secret, skey, true);
+    
+    // PadC is left empty, as other clients do
+    std::string encrypted = verificationConstant() + uint32Bytes(crypto_provide) + uint16Bytes(0) +
+                            uint16Bytes(initial_payload.size()) + initial_payload;
+    cipher.encrypt(encrypted.data(), encrypted.size());
+    socket.write(req1Hash(secret) + req2Req3Hash(secret, skey) + encrypted);
+    
+    // PadB runs until the encrypted verification constant; decrypting the
+    // constant yields it and moves the stream past it
+    std::string marker = verificationConstant();
+    cipher.decrypt(marker.data(), marker.size());
+    socket.scanFor(marker, MAX_PADDING + marker.size());
+    
+    std::string header = socket.read(6);
+    cipher.decrypt(header.data(), header.size());
+    uint32_t select = readUint32(header, 0);
+    if ((select & (select - 1)) != 0 || (select & crypto_provide) == 0) {
+        throw std::runtime_error("Invalid MSE crypto_select");
+    }
+    std::string padding = socket.read(readPaddingLength(header, 4));
+    cipher.decrypt(padding.data(), padding.size());
+    
+    HandshakeResult result{static_cast<CryptoMethod>(select), skey, "", std::nullopt};
+    if (select == CRYPTO_RC4) {
+        result.cipher = std::move(cipher);
+    }
+    return result;
+}
+
+HandshakeResult respondHandshake(int fd, const std::vector<std::string>& skeys, uint32_t crypto_allowed) {
+    HandshakeSocket socket(fd);
+    KeyExchange keys;
+    std::string secret = keys.computeSecret(socket.read(KEY_SIZE));
+    socket.write(keys.getPublicKey() + makePadding());
+    
+    // PadA runs until HASH('req1', S)
+    socket.scanFor(req1Hash(secret), MAX_PADDING + HASH_SIZE);
+    std::string torrent = socket.read(HASH_SIZE);
+    auto skey = std::find_if(skeys.begin(), skeys.end(), [&](const std::string& candidate) {
+        return req2Req3Hash(secret, candidate) == torrent;
+    });
+    if (skey == skeys.end()) {
+        throw std::runtime_error("MSE handshake for an unknown torrent");
+    }
+    CipherStream cipher(secret, *skey, false);
+    
+    const std::string& vc = verificationConstant();
+    std::string header = socket.read(vc.size() + 6);
+    cipher.decrypt(header.data(), header.size());
+    if (header.compare(0, vc.size(), vc) != 0) {
+        throw std::runtime_error("MSE verification constant mismatch");
+    }
+    uint32_t provide = readUint32(header, vc.size());
+    size_t padding_length = readPaddingLength(header, vc.size() + 4);
+    
+    // PadC and len(IA) together
+    std::string padding = socket.read(padding_length + 2);
+    cipher.decrypt(padding.data(), padding.size());
+    std::string initial_payload = socket.read(readUint16(padding, padding_length));
+    cipher.decrypt(initial_payload.data(), initial_payload.size());
+    
+    uint32_t common = provide & crypto_allowed;
+    uint32_t select = (common & CRYPTO_RC4) ? CRYPTO_RC4 : (common & CRYPTO_PLAINTEXT);
+    if (select == 0) {
+        throw std::runtime_error("No MSE crypto method in common");
+    }
+    
+    // PadD is left empty, as other clients do
+    std::string reply = vc + uint32Bytes(select) + uint16Bytes(0);
+    cipher.encrypt(reply.data(), reply.size());
+    socket.write(reply);
+    
+    HandshakeResult result{static_cast<CryptoMethod>(select), *skey, initial_payload, std::nullopt};
+    if (select == CRYPTO_RC4) {
+        result.cipher = std::move(cipher);
+    }
+    return result;
+}
+
+} // namespace mse
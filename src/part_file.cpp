@@ -0,0 +1,136 @@
+#include "part_file.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t SLOT_ENTRY_SIZE = 4;
+
+void encodeSlot(uint32_t slot, unsigned char* out) {
+    out[0] = static_cast<unsigned char>(slot >> 24);
+    out[1] = static_cast<unsigned char>(slot >> 16);
+    out[2] = static_cast<unsigned char>(slot >> 8);
+    out[3] = static_cast<unsigned char>(slot);
+}
+
+uint32_t decodeSlot(const unsigned char* in) {
+    return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+           (static_cast<uint32_t>(in[2]) << 8) | static_cast<uint32_t>(in[3]);
+}
+
+} // namespace
+
+PartFile::PartFile(const std::string& path, size_t num_pieces, size_t piece_length)
+    : path_(path), piece_length_(piece_length), slots_(num_pieces, 0) {
+    // An existing partfile is loaded right away; a new one is only created
+    // once the first slot is needed
+    int fd = ::open(path_.c_str(), O_RDWR);
+    if (fd < 0) {
+        return;
+    }
+    fd_ = fd;
+    
+    std::vector<unsigned char> table(slots_.size() * SLOT_ENTRY_SIZE);
+    ssize_t n = ::pread(fd_, table.data(), table.size(), 0);
+    if (n != static_cast<ssize_t>(table.size())) {
+        throw std::runtime_error("Corrupt partfile: " + path_);
+    }
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        slots_[i] = decodeSlot(&table[i * SLOT_ENTRY_SIZE]);
+        num_slots_ = std::max(num_slots_, slots_[i]);
+    }
+    
+    // Slots below the highest one in use that no piece refers to were freed
+    std::vector<bool> used(num_slots_ + 1, false);
+    for (uint32_t slot : slots_) {
+        used[slot] = true;
+    }
+    for (uint32_t slot = 1; slot <= num_slots_; ++slot) {
+        if (!used[slot]) {
+            free_slots_.push_back(slot);
+        }
+    }
+}
+
+PartFile::~PartFile() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void PartFile::open() {
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to open partfile " + path_ + ": " + std::strerror(errno));
+    }
+    if (::ftruncate(fd_, static_cast<off_t>(slots_.size() * SLOT_ENTRY_SIZE)) != 0) {
+        throw std::runtime_error("Failed to size partfile " + path_ + ": " + std::strerror(errno));
+    }
+}
+
+void PartFile::writeSlotEntry(size_t piece, uint32_t slot) {
+    unsigned char entry[SLOT_ENTRY_SIZE];
+    encodeSlot(slot, entry);
+    if (::pwrite(fd_, entry, sizeof(entry), static_cast<off_t>(piece * SLOT_ENTRY_SIZE)) !=
+        static_cast<ssize_t>(sizeof(entry))) {
+        throw std::runtime_error("Failed to update partfile " + path_ + ": " + std::strerror(errno));
+    }
+}
+
+void PartFile::freePiece(size_t piece) {
+    if (!hasPiece(piece)) {
+        return;
+    }
+    uint32_t slot = slots_[piece];
+    writeSlotEntry(piece, 0);
+    slots_[piece] = 0;
+    free_slots_.push_back(slot);
+    
+    // Give the disk space back; the slot stays in the file for reuse. Not
+    // every filesystem can punch holes, which only costs space.
+    ::fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                static_cast<off_t>(slotOffset(slot)), static_cast<off_t>(piece_length_));
+}
+
+uint64_t PartFile::slotOffset(uint32_t slot) const {
+    return slots_.size() * SLOT_ENTRY_SIZE + static_cast<uint64_t>(slot - 1) * piece_length_;
+}
+
+std::optional<DiskRequest> PartFile::map(DiskOp op, size_t piece, size_t offset, char* buffer, size_t length) {
+    if (piece >= slots_.size() || offset + length > piece_length_) {
+        throw std::out_of_range("Partfile range exceeds piece bounds");
+    }
+    
+    if (slots_[piece] == 0) {
+        if (op == DiskOp::READ) {
+            return std::nullopt;
+        }
+        if (fd_ < 0) {
+            open();
+        }
+        
+        uint32_t slot;
+        if (!free_slots_.empty()) {
+            // Unwritten parts of a reused slot are not guaranteed to be zero,
+            // which is fine as a piece is only used once fully verified
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+        } else {
+            slot = num_slots_ + 1;
+            // Size the slot first so reads of its unwritten parts never hit EOF
+            if (::ftruncate(fd_, static_cast<off_t>(slotOffset(slot) + piece_length_)) != 0) {
+                throw std::runtime_error("Failed to grow partfile " + path_ + ": " + std::strerror(errno));
+            }
+            num_slots_ = slot;
+        }
+        writeSlotEntry(piece, slot);
+        slots_[piece] = slot;
+    }
+    
+    return DiskRequest{op, fd_, slotOffset(slots_[piece]) + offset, buffer, length};
+}
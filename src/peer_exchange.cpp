@@ -0,0 +1,145 @@
+#include "peer_exchange.hpp"
+#include "bencode_parser.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Missing fields read as empty; any other type than a string is malformed
+std::string stringField(const bencode::BencodeDict& dict, const std::string& key) {
+    auto it = dict.find(key);
+    if (it == dict.end()) {
+        return "";
+    }
+    if (!it->second->isString()) {
+        throw std::runtime_error("Invalid PEX message: " + key + " is not a string");
+    }
+    return it->second->asString();
+}
+
+} // namespace
+
+std::string PeerExchange::encode(const PexMessage& message) {
+    std::vector<Peer> added;
+    std::string added_flags;
+    for (size_t i = 0; i < message.added.size(); ++i) {
+        // Only IPv4 peers fit the compact "added" field
+        if (TrackerClient::encodeCompactPeers({message.added[i]}).empty()) {
+            continue;
+        }
+        added.push_back(message.added[i]);
+        added_flags += static_cast<char>(i < message.added_flags.size() ? message.added_flags[i] : 0);
+    }
+    
+    bencode::BencodeDict dict;
+    dict["added"] = std::make_shared<bencode::BencodeValue>(TrackerClient::encodeCompactPeers(added));
+    dict["added.f"] = std::make_shared<bencode::BencodeValue>(added_flags);
+    dict["dropped"] = std::make_shared<bencode::BencodeValue>(TrackerClient::encodeCompactPeers(message.dropped));
+    return bencode::BencodeValue(dict).encode();
+}
+
+PexMessage PeerExchange::decode(const std::string& payload) {
+    auto parsed = bencode::BencodeParser::parse(payload);
+    if (!parsed->isDict()) {
+        throw std::runtime_error("Invalid PEX message: not a dictionary");
+    }
+    
+    const auto& dict = parsed->asDict();
+    PexMessage message;
+    
+    message.added = TrackerClient::parseCompactPeers(stringField(dict, "added"));
+    
+    std::string flags = stringField(dict, "added.f");
+    message.added_flags.assign(flags.begin(), flags.end());
+    message.added_flags.resize(message.added.size(), 0);
+    
+    message.dropped = TrackerClient::parseCompactPeers(stringField(dict, "dropped"));
+    
+    return message;
+}
+
+PeerList::PeerList(size_t max_peers, Clock::duration min_merge_interval)
+    : max_peers_(max_peers), min_merge_interval_(min_merge_interval) {}
+
+bool PeerList::insert(const Peer& peer, uint8_t flags) {
+    if (peer.port == 0) {
+        return false;
+    }
+    Endpoint endpoint{peer.ip, peer.port};
+    if (auto it = peers_.find(endpoint); it != peers_.end()) {
+        it->second |= flags;
+        return false;
+    }
+    if (peers_.size() >= max_peers_) {
+        return false;
+    }
+    peers_.emplace(endpoint, flags);
+    return true;
+}
+
+size_t PeerList::add(const std::vector<Peer>& peers) {
+    size_t added = 0;
+    for (const auto& peer : peers) {
+        if (insert(peer, 0)) {
+            added++;
+        }
+    }
+    return added;
+}
+
+void PeerList::remove(const Peer& peer) {
+    peers_.erase({peer.ip, peer.port});
+}
+
+size_t PeerList::mergePex(const std::string& source, const PexMessage& message, Clock::time_point now) {
+    if (auto it = last_merge_.find(source); it != last_merge_.end() && now - it->second < min_merge_interval_) {
+        return 0;
+    }
+    last_merge_[source] = now;
+    
+    // Dropped peers are only gone from the sender's view, so they stay listed
+    size_t count = std::min(message.added.size(), MAX_PEX_PEERS);
+    size_t added = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t flags = i < message.added_flags.size() ? message.added_flags[i] : 0;
+        if (insert(message.added[i], flags)) {
+            added++;
+        }
+    }
+    return added;
+}
+
+PexMessage PeerList::makeDelta(const std::string& destination) {
+    auto& sent = last_sent_[destination];
+    PexMessage message;
+    
+    for (const auto& [endpoint, flags] : peers_) {
+        if (message.added.size() >= MAX_PEX_PEERS) {
+            break;
+        }
+        if (sent.insert(endpoint).second) {
+            message.added.push_back({endpoint.first, endpoint.second});
+            message.added_flags.push_back(flags);
+        }
+    }
+    
+    for (auto it = sent.begin(); it != sent.end() && message.dropped.size() < MAX_PEX_PEERS;) {
+        if (peers_.count(*it) == 0) {
+            message.dropped.push_back({it->first, it->second});
+            it = sent.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    return message;
+}
+
+std::vector<Peer> PeerList::getPeers() const {
+    std::vector<Peer> peers;
+    peers.reserve(peers_.size());
+    for (const auto& [endpoint, flags] : peers_) {
+        peers.push_back({endpoint.first, endpoint.second});
+    }
+    return peers;
+}
@@ -0,0 +1,229 @@
+#include "piece_picker.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+PiecePicker::PiecePicker(size_t num_pieces)
+    : have_(num_pieces, false),
+      reserved_(num_pieces, false),
+      availability_(num_pieces, 0),
+      priorities_(num_pieces, DownloadPriority::NORMAL),
+      deadlines_(num_pieces) {}
+
+void PiecePicker::checkIndex(size_t index) const {
+    if (index >= have_.size()) {
+        throw std::out_of_range("Piece index out of range");
+    }
+}
+
+size_t PiecePicker::getNumHave() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_have_;
+}
+
+bool PiecePicker::isComplete() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_have_ == have_.size();
+}
+
+void PiecePicker::incrementAvailability(size_t index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    checkIndex(index);
+    availability_[index]++;
+}
+
+void PiecePicker::decrementAvailability(size_t index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    checkIndex(index);
+    if (availability_[index] > 0) {
+        availability_[index]--;
+    }
+}
+
+void PiecePicker::addPeerBitfield(const std::vector<bool>& bitfield) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = std::min(bitfield.size(), availability_.size());
+    for (size_t i = 0; i < count; ++i) {
+        if (bitfield[i]) {
+            availability_[i]++;
+        }
+    }
+}
+
+void PiecePicker::removePeerBitfield(const std::vector<bool>& bitfield) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = std::min(bitfield.size(), availability_.size());
+    for (size_t i = 0; i < count; ++i) {
+        if (bitfield[i] && availability_[i] > 0) {
+            availability_[i]--;
+        }
+    }
+}
+
+void PiecePicker::markHave(size_t index) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        checkIndex(index);
+        if (have_[index]) {
+            return;
+        }
+        have_[index] = true;
+        reserved_[index] = false;
+        num_have_++;
+
+        // A verified piece no longer needs its deadline
+        if (deadlines_[index]) {
+            deadline_queue_.erase({*deadlines_[index], index});
+            deadlines_[index].reset();
+        }
+    }
+    have_cv_.notify_all();
+}
+
+bool PiecePicker::havePiece(size_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    checkIndex(index);
+    return have_[index];
+}
+
+bool PiecePicker::haveRange(const PieceRange& range) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = range.first; i < range.last; ++i) {
+        checkIndex(i);
+        if (!have_[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void PiecePicker::setDeadline(size_t index, Clock::time_point deadline) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    checkIndex(index);
+    if (have_[index]) {
+        return;
+    }
+
+    auto& current = deadlines_[index];
+    if (current) {
+        if (*current <= deadline) {
+            return;
+        }
+        deadline_queue_.erase({*current, index});
+    }
+    current = deadline;
+    deadline_queue_.insert({deadline, index});
+}
+
+void PiecePicker::clearDeadline(size_t index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    checkIndex(index);
+    if (deadlines_[index]) {
+        deadline_queue_.erase({*deadlines_[index], index});
+        deadlines_[index].reset();
+    }
+}
+
+void PiecePicker::clearDeadlines() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [deadline, index] : deadline_queue_) {
+        deadlines_[index].reset();
+    }
+    deadline_queue_.clear();
+}
+
+void PiecePicker::setPriority(size_t index, DownloadPriority priority) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    checkIndex(index);
+    priorities_[index] = priority;
+}
+
+DownloadPriority PiecePicker::getPriority(size_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    checkIndex(index);
+    return priorities_[index];
+}
+
+void PiecePicker::setSequential(bool sequential) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sequential_ = sequential;
+}
+
+bool PiecePicker::isSequential() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sequential_;
+}
+
+std::optional<size_t> PiecePicker::pickPiece(const std::vector<bool>& peer_has) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pickLocked(peer_has);
+}
+
+std::optional<size_t> PiecePicker::reservePiece(const std::vector<bool>& peer_has) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto piece = pickLocked(peer_has);
+    if (piece) {
+        reserved_[*piece] = true;
+    }
+    return piece;
+}
+
+void PiecePicker::releasePiece(size_t index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    checkIndex(index);
+    reserved_[index] = false;
+}
+
+bool PiecePicker::isReserved(size_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    checkIndex(index);
+    return reserved_[index];
+}
+
+std::optional<size_t> PiecePicker::pickLocked(const std::vector<bool>& peer_has) const {
+    auto peerHas = [&](size_t index) {
+        return index < peer_has.size() && peer_has[index] && !reserved_[index];
+    };
+
+    // Earliest deadline the peer can serve wins
+    for (const auto& [deadline, index] : deadline_queue_) {
+        if (peerHas(index)) {
+            return index;
+        }
+    }
+
+    std::optional<size_t> best;
+    DownloadPriority best_priority = DownloadPriority::SKIP;
+    uint32_t best_availability = std::numeric_limits<uint32_t>::max();
+    for (size_t i = 0; i < have_.size(); ++i) {
+        if (have_[i] || !peerHas(i) || priorities_[i] < best_priority ||
+            priorities_[i] == DownloadPriority::SKIP) {
+            continue;
+        }
+        
+        // Sequential mode keeps the lowest index within a priority level
+        bool better = priorities_[i] > best_priority ||
+                      (!sequential_ && availability_[i] < best_availability);
+        if (better) {
+            best = i;
+            best_priority = priorities_[i];
+            best_availability = availability_[i];
+        }
+    }
+    return best;
+}
+
+bool PiecePicker::waitForRange(const PieceRange& range, Clock::duration timeout) const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (size_t i = range.first; i < range.last; ++i) {
+        checkIndex(i);
+    }
+    return have_cv_.wait_for(lock, timeout, [&] {
+        for (size_t i = range.first; i < range.last; ++i) {
+            if (!have_[i]) {
+                return false;
+            }
+        }
+        return true;
+    });
+}
@@ -0,0 +1,325 @@
+#include "piece_storage.hpp"
+#include "logger.hpp"
+#include <openssl/sha.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+PieceStorage::PieceStorage(const TorrentFile& torrent,
+                           const std::string& download_dir,
+                           const FileSelection* selection,
+                           std::unique_ptr<DiskBackend> backend)
+    : torrent_(torrent),
+      download_dir_(download_dir),
+      selection_(selection),
+      backend_(std::move(backend)),
+      files_(torrent.getInfo().files.size()),
+      part_file_(download_dir + "/." + torrent.getInfo().name + ".parts",
+                 torrent.getNumPieces(), torrent.getInfo().piece_length) {
+    std::filesystem::create_directories(download_dir_);
+    
+    // Skipped files are still used if they are already on disk
+    on_disk_.resize(files_.size());
+    for (size_t i = 0; i < files_.size(); ++i) {
+        on_disk_[i] = !selection_ || selection_->isWanted(i) ||
+                      std::filesystem::exists(torrent_.getFilePath(i, download_dir_));
+    }
+    Logger::debug("Piece storage using " + backend_->name() + " disk backend");
+}
+
+PieceStorage::~PieceStorage() {
+    for (const auto& file : files_) {
+        if (file.fd >= 0) {
+            ::close(file.fd);
+        }
+    }
+}
+
+void PieceStorage::setMaxOpenFiles(size_t max_open_files) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_open_files_ = std::max<size_t>(1, max_open_files);
+    closeIdleFiles(max_open_files_);
+}
+
+size_t PieceStorage::getMaxOpenFiles() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return max_open_files_;
+}
+
+size_t PieceStorage::getNumOpenFiles() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lru_.size();
+}
+
+void PieceStorage::closeIdleFiles(size_t max_open) {
+    // Oldest first, skipping files an in-flight request still uses
+    for (auto it = lru_.end(); lru_.size() > max_open && it != lru_.begin();) {
+        --it;
+        OpenFile& file = files_[*it];
+        if (file.pins == 0) {
+            ::close(file.fd);
+            file.fd = -1;
+            it = lru_.erase(it);
+        }
+    }
+}
+
+int PieceStorage::pinFile(size_t file_index, bool create) {
+    OpenFile& file = files_[file_index];
+    if (file.fd >= 0) {
+        lru_.splice(lru_.begin(), lru_, file.lru);
+        file.pins++;
+        return file.fd;
+    }
+    
+    closeIdleFiles(max_open_files_ - 1);
+    
+    const auto& info = torrent_.getInfo().files[file_index];
+    std::filesystem::path path = torrent_.getFilePath(file_index, download_dir_);
+    if (create && path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path());
+    }
+    
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT : 0), 0644);
+    if (fd < 0) {
+        if (!create && (errno == ENOENT || errno == ENOTDIR)) {
+            return -1;
+        }
+        throw std::runtime_error("Failed to open " + path.string() + ": " + std::strerror(errno));
+    }
+    
+    // Preallocate as a sparse file so reads of missing pieces never hit EOF.
+    // Reads leave a short file alone and treat it as missing instead.
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && static_cast<uint64_t>(st.st_size) < info.length) {
+        if (!create) {
+            ::close(fd);
+            return -1;
+        }
+        if (::ftruncate(fd, static_cast<off_t>(info.length)) != 0) {
+            int err = errno;
+            ::close(fd);
+            throw std::runtime_error("Failed to size " + path.string() + ": " + std::strerror(err));
+        }
+    }
+    
+    file.fd = fd;
+    file.pins = 1;
+    lru_.push_front(file_index);
+    file.lru = lru_.begin();
+    return fd;
+}
+
+void PieceStorage::unpin(const std::vector<size_t>& files) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t index : files) {
+        files_[index].pins--;
+    }
+    // Files kept open past the limit by pins are closed once released
+    closeIdleFiles(max_open_files_);
+}
+
+void PieceStorage::moveFromPartFile(size_t file_index) {
+    const auto& info = torrent_.getInfo();
+    const auto& file = info.files[file_index];
+    if (file.length == 0) {
+        return;
+    }
+    
+    // Any piece of the file can be in the partfile, not just its boundary
+    // pieces: deadlines let skipped pieces be downloaded as well
+    PieceRange pieces = torrent_.getPieceRange(file_index, 0, file.length);
+    for (size_t piece = pieces.first; piece < pieces.last; ++piece) {
+        if (!part_file_.hasPiece(piece)) {
+            continue;
+        }
+        uint64_t piece_start = static_cast<uint64_t>(piece) * info.piece_length;
+        uint64_t start = std::max<uint64_t>(piece_start, file.offset);
+        uint64_t end = std::min<uint64_t>(piece_start + torrent_.getPieceSize(piece),
+                                          file.offset + file.length);
+        
+        std::string data(end - start, '\0');
+        auto request = part_file_.map(DiskOp::READ, piece, start - piece_start, data.data(), data.length());
+        backend_->submit({*request});
+        
+        int fd = pinFile(file_index, true);
+        try {
+            backend_->submit({{DiskOp::WRITE, fd, start - file.offset, data.data(), data.length()}});
+        } catch (...) {
+            files_[file_index].pins--;
+            throw;
+        }
+        files_[file_index].pins--;
+        
+        // The slot can go once no file in the piece still depends on it
+        size_t first = torrent_.getFileIndexAt(piece_start);
+        size_t last = torrent_.getFileIndexAt(piece_start + torrent_.getPieceSize(piece) - 1) + 1;
+        bool needed = false;
+        for (size_t i = first; i < last; ++i) {
+            needed = needed || (!on_disk_[i] && info.files[i].length > 0);
+        }
+        if (!needed) {
+            part_file_.freePiece(piece);
+        }
+    }
+}
+
+void PieceStorage::updateFileSelection() {
+    if (!selection_) {
+        return;
+    }
+    
+    std::unique_lock<std::shared_mutex> io_lock(io_mutex_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < on_disk_.size(); ++i) {
+        if (on_disk_[i] || !selection_->isWanted(i)) {
+            continue;
+        }
+        on_disk_[i] = true;
+        moveFromPartFile(i);
+    }
+    closeIdleFiles(max_open_files_);
+}
+
+void PieceStorage::checkBlock(size_t piece, size_t offset, size_t length) const {
+    size_t piece_size = torrent_.getPieceSize(piece);
+    if (offset > piece_size || length > piece_size - offset) {
+        throw std::out_of_range("Block exceeds piece bounds");
+    }
+}
+
+void PieceStorage::mapPartFile(DiskOp op, uint64_t offset, char* buffer, size_t length, MappedRange& range) {
+    // Partfile slots are per piece, so split the chunk at piece boundaries
+    const size_t piece_length = torrent_.getInfo().piece_length;
+    while (length > 0) {
+        size_t piece = static_cast<size_t>(offset / piece_length);
+        size_t piece_offset = static_cast<size_t>(offset % piece_length);
+        size_t chunk = std::min(length, piece_length - piece_offset);
+        if (auto request = part_file_.map(op, piece, piece_offset, buffer, chunk)) {
+            range.requests.push_back(*request);
+        } else {
+            std::memset(buffer, 0, chunk);
+        }
+        offset += chunk;
+        buffer += chunk;
+        length -= chunk;
+    }
+}
+
+PieceStorage::MappedRange PieceStorage::mapRange(DiskOp op, uint64_t offset, char* buffer, size_t length) {
+    const auto& info = torrent_.getInfo();
+    MappedRange range;
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    try {
+        size_t index = length > 0 ? torrent_.getFileIndexAt(offset) : info.files.size();
+        while (length > 0 && index < info.files.size()) {
+            const auto& file = info.files[index];
+            uint64_t file_end = file.offset + file.length;
+            if (offset < file_end) {
+                size_t chunk = static_cast<size_t>(std::min<uint64_t>(length, file_end - offset));
+                int fd = on_disk_[index] ? pinFile(index, op == DiskOp::WRITE) : -1;
+                if (fd >= 0) {
+                    range.pinned.push_back(index);
+                    range.requests.push_back({op, fd, offset - file.offset, buffer, chunk});
+                } else if (on_disk_[index]) {
+                    // Reading a file that was never written: nothing there yet
+                    std::memset(buffer, 0, chunk);
+                } else {
+                    mapPartFile(op, offset, buffer, chunk, range);
+                }
+                offset += chunk;
+                buffer += chunk;
+                length -= chunk;
+            }
+            ++index;
+        }
+        
+        if (length > 0) {
+            throw std::out_of_range("Range exceeds torrent length");
+        }
+    } catch (...) {
+        for (size_t pinned : range.pinned) {
+            files_[pinned].pins--;
+        }
+        throw;
+    }
+    return range;
+}
+
+void PieceStorage::transfer(DiskOp op, uint64_t offset, char* buffer, size_t length) {
+    std::shared_lock<std::shared_mutex> io_lock(io_mutex_);
+    MappedRange range = mapRange(op, offset, buffer, length);
+    try {
+        backend_->submit(range.requests);
+    } catch (...) {
+        unpin(range.pinned);
+        throw;
+    }
+    unpin(range.pinned);
+}
+
+void PieceStorage::writeBlock(size_t piece, size_t offset, const char* data, size_t length) {
+    checkBlock(piece, offset, length);
+    uint64_t start = static_cast<uint64_t>(piece) * torrent_.getInfo().piece_length + offset;
+    // Writes only read from the buffer; DiskRequest is shared with reads
+    transfer(DiskOp::WRITE, start, const_cast<char*>(data), length);
+}
+
+void PieceStorage::readBlock(size_t piece, size_t offset, char* data, size_t length) {
+    checkBlock(piece, offset, length);
+    uint64_t start = static_cast<uint64_t>(piece) * torrent_.getInfo().piece_length + offset;
+    transfer(DiskOp::READ, start, data, length);
+}
+
+void PieceStorage::writeBlock(size_t piece, size_t offset, const BufferHandle& block) {
+    writeBlock(piece, offset, block.data(), block.size());
+}
+
+BufferHandle PieceStorage::readBlock(size_t piece, size_t offset, size_t length, BufferPool& pool) {
+    BufferHandle block = pool.acquire();
+    block.resize(length);
+    readBlock(piece, offset, block.data(), length);
+    return block;
+}
+
+void PieceStorage::readFile(size_t file_index, uint64_t offset, char* data, size_t length) {
+    const auto& files = torrent_.getInfo().files;
+    if (file_index >= files.size()) {
+        throw std::out_of_range("File index out of range");
+    }
+    const auto& file = files[file_index];
+    if (offset > file.length || length > file.length - offset) {
+        throw std::out_of_range("Byte range exceeds file length");
+    }
+    transfer(DiskOp::READ, file.offset + offset, data, length);
+}
+
+void PieceStorage::registerBufferPool(const BufferPool& pool) {
+    backend_->registerBuffers(pool.getSlabs());
+}
+
+void PieceStorage::writePiece(size_t piece, const std::string& data) {
+    if (data.length() != torrent_.getPieceSize(piece)) {
+        throw std::runtime_error("Piece data has wrong length");
+    }
+    writeBlock(piece, 0, data.data(), data.length());
+}
+
+std::string PieceStorage::readPiece(size_t piece) {
+    std::string data(torrent_.getPieceSize(piece), '\0');
+    readBlock(piece, 0, data.data(), data.length());
+    return data;
+}
+
+bool PieceStorage::verifyPiece(size_t piece) {
+    std::string data = readPiece(piece);
+    unsigned char hash[SHA_DIGEST_LENGTH];
+    SHA1(reinterpret_cast<const unsigned char*>(data.data()), data.length(), hash);
+    return torrent_.getPieceHash(piece) == std::string(reinterpret_cast<char*>(hash), SHA_DIGEST_LENGTH);
+}
\ No newline at end of file
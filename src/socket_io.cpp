@@ -0,0 +1,258 @@
+#include "socket_io.hpp"
+#include "io_uring.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/socket.h>
+
+// IORING_OP_SEND_ZC and its flags arrived together in the 6.0 headers
+#if defined(BITTORRENT_HAVE_IO_URING) && defined(IORING_RECVSEND_FIXED_BUF)
+#define BITTORRENT_HAVE_SEND_ZC
+#endif
+
+namespace {
+
+std::string errnoMessage(const std::string& what, int err) {
+    return what + ": " + std::strerror(err);
+}
+
+} // namespace
+
+void PosixSocketBackend::submit(const std::vector<SocketRequest>& requests) {
+    for (const auto& request : requests) {
+        bool send = request.op == SocketOp::SEND;
+        size_t done = 0;
+        while (done < request.length) {
+            ssize_t n;
+            if (send) {
+                n = ::send(request.fd, request.buffer + done, request.length - done, MSG_NOSIGNAL);
+            } else {
+                n = ::recv(request.fd, request.buffer + done, request.length - done, MSG_WAITALL);
+            }
+            syscalls_.fetch_add(1, std::memory_order_relaxed);
+            
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    pollfd ready{request.fd, static_cast<short>(send ? POLLOUT : POLLIN), 0};
+                    ::poll(&ready, 1, -1);
+                    syscalls_.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                throw std::runtime_error(errnoMessage("Socket I/O failed", errno));
+            }
+            if (n == 0) {
+                throw std::runtime_error("Connection closed by peer");
+            }
+            done += static_cast<size_t>(n);
+        }
+        requests_.fetch_add(1, std::memory_order_relaxed);
+        bytes_.fetch_add(request.length, std::memory_order_relaxed);
+    }
+}
+
+#ifdef BITTORRENT_HAVE_IO_URING
+
+namespace {
+
+// Requests on the same socket are linked so the kernel runs them in order;
+// a short transfer breaks the link and the rest of the chain is requeued
+class IoUringSocketBackend : public SocketBackend {
+public:
+    IoUringSocketBackend(std::unique_ptr<IoUring> ring, size_t zero_copy_threshold)
+        : ring_(std::move(ring)), zero_copy_threshold_(zero_copy_threshold) {}
+    
+    void submit(const std::vector<SocketRequest>& requests) override;
+    void registerBuffers(const std::vector<iovec>& buffers) override;
+    std::string name() const override { return zero_copy_threshold_ > 0 ? "io_uring_zc" : "io_uring"; }
+    
+private:
+    // Returns whether the request went out as a zero-copy send
+    bool prepare(const SocketRequest& request, size_t done, uint64_t user_data, bool link);
+    int enter(unsigned to_submit, unsigned min_complete);
+    
+    std::unique_ptr<IoUring> ring_;
+    size_t zero_copy_threshold_;
+    // One batch owns the ring at a time
+    std::mutex mutex_;
+    bool broken_ = false;  // Completions could not be reaped after an error
+};
+
+void IoUringSocketBackend::registerBuffers(const std::vector<iovec>& buffers) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ring_->registerBuffers(buffers);
+}
+
+bool IoUringSocketBackend::prepare(const SocketRequest& request, size_t done, uint64_t user_data, bool link) {
+    io_uring_sqe* sqe = ring_->prepare();
+    char* buffer = request.buffer + done;
+    size_t length = request.length - done;
+    
+    sqe->fd = request.fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = static_cast<uint32_t>(length);
+    sqe->user_data = user_data;
+    if (link) {
+        sqe->flags |= IOSQE_IO_LINK;
+    }
+    
+    // MSG_WAITALL makes the kernel retry short transfers itself
+    if (request.op == SocketOp::RECV) {
+        sqe->opcode = IORING_OP_RECV;
+        sqe->msg_flags = MSG_WAITALL;
+        return false;
+    }
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    
+#ifdef BITTORRENT_HAVE_SEND_ZC
+    if (zero_copy_threshold_ > 0 && length >= zero_copy_threshold_) {
+        sqe->opcode = IORING_OP_SEND_ZC;
+        int buf_index = ring_->findRegisteredBuffer(buffer, length);
+        if (buf_index >= 0) {
+            sqe->ioprio |= IORING_RECVSEND_FIXED_BUF;
+            sqe->buf_index = static_cast<uint16_t>(buf_index);
+        }
+        return true;
+    }
+#endif
+    sqe->opcode = IORING_OP_SEND;
+    return false;
+}
+
+int IoUringSocketBackend::enter(unsigned to_submit, unsigned min_complete) {
+    syscalls_.fetch_add(1, std::memory_order_relaxed);
+    return ring_->enter(to_submit, min_complete);
+}
+
+void IoUringSocketBackend::submit(const std::vector<SocketRequest>& requests) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (broken_) {
+        throw std::runtime_error("io_uring socket backend unusable after an earlier failure");
+    }
+    
+    std::vector<size_t> done(requests.size(), 0);
+    std::vector<bool> zero_copy(requests.size(), false);
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        if (requests[i].length > 0) {
+            pending.push_back(i);
+        }
+    }
+    
+    while (!pending.empty()) {
+        size_t batch = std::min<size_t>(pending.size(), ring_->getEntries());
+        for (size_t i = 0; i < batch; ++i) {
+            size_t id = pending[i];
+            bool link = i + 1 < batch && requests[pending[i + 1]].fd == requests[id].fd;
+            zero_copy[id] = prepare(requests[id], done[id], id, link);
+        }
+        
+        // A zero-copy send completes twice: once sent, and once the kernel
+        // no longer needs the buffer. Both must be in before returning.
+        unsigned submitted = 0;
+        unsigned completed = 0;
+        unsigned notifications = 0;
+        std::string error;
+        while (completed < batch || notifications > 0) {
+            unsigned to_submit = static_cast<unsigned>(batch) - submitted;
+            int ret = enter(to_submit, static_cast<unsigned>(batch) - completed + notifications);
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                int err = errno;
+                ring_->discardUnsubmitted();
+                if (!ring_->drain(submitted - completed + notifications)) {
+                    broken_ = true;
+                }
+                throw std::runtime_error(errnoMessage("io_uring_enter failed", err));
+            }
+            submitted += static_cast<unsigned>(ret);
+            
+            ring_->reap([&](const io_uring_cqe& cqe) {
+                size_t id = static_cast<size_t>(cqe.user_data);
+#ifdef BITTORRENT_HAVE_SEND_ZC
+                if (cqe.flags & IORING_CQE_F_NOTIF) {
+                    notifications--;
+                    return;
+                }
+                if (cqe.flags & IORING_CQE_F_MORE) {
+                    notifications++;
+                }
+#endif
+                completed++;
+                if (cqe.res == -ECANCELED) {
+                    // An earlier request in the chain fell short; requeued below
+                    return;
+                }
+                if (cqe.res == -EOPNOTSUPP && zero_copy[id]) {
+                    // Not every socket type takes zero-copy sends
+                    Logger::debug("Zero-copy send unsupported on socket, copying instead");
+                    zero_copy_threshold_ = 0;
+                    return;
+                }
+                if (cqe.res < 0) {
+                    error = errnoMessage("Socket I/O failed", -cqe.res);
+                } else if (cqe.res == 0) {
+                    error = "Connection closed by peer";
+                } else {
+                    done[id] += static_cast<size_t>(cqe.res);
+                    if (zero_copy[id]) {
+                        zero_copy_sends_.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            });
+        }
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+        
+        // Unfinished requests keep their order, which is the stream order
+        std::vector<size_t> next;
+        for (size_t i = 0; i < batch; ++i) {
+            size_t id = pending[i];
+            if (done[id] < requests[id].length) {
+                next.push_back(id);
+            }
+        }
+        next.insert(next.end(), pending.begin() + batch, pending.end());
+        pending.swap(next);
+    }
+    
+    requests_.fetch_add(requests.size(), std::memory_order_relaxed);
+    for (const auto& request : requests) {
+        bytes_.fetch_add(request.length, std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+#endif
+
+std::unique_ptr<SocketBackend> createSocketBackend(bool prefer_io_uring, size_t zero_copy_threshold) {
+#ifdef BITTORRENT_HAVE_IO_URING
+    if (prefer_io_uring) {
+        if (auto ring = IoUring::create(256)) {
+#ifdef BITTORRENT_HAVE_SEND_ZC
+            if (!ring->supports(IORING_OP_SEND_ZC)) {
+                zero_copy_threshold = 0;
+            }
+#else
+            zero_copy_threshold = 0;
+#endif
+            return std::make_unique<IoUringSocketBackend>(std::move(ring), zero_copy_threshold);
+        }
+        Logger::info("io_uring not supported by this kernel, using portable socket I/O");
+    }
+#else
+    (void)prefer_io_uring;
+    (void)zero_copy_threshold;
+#endif
+    return std::make_unique<PosixSocketBackend>();
+}
@@ -3,9 +3,23 @@
 #include <openssl/sha.h>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+
+namespace {
+
+// A file name or directory taken from the torrent must stay a single
+// component inside the download directory
+void checkPathComponent(const std::string& component) {
+    if (component.empty() || component == "." || component == ".." ||
+        component.find_first_of(std::string("/\\\0", 3)) != std::string::npos) {
+        throw std::runtime_error("Invalid torrent file: unsafe path component '" + component + "'");
+    }
+}
+
+} // namespace
 
 TorrentFile::TorrentFile(const std::string& filename) {
-    auto parsed = bencode::BencodeParser::parseFile(filename);
+    auto parsed = bencode::BencodeParser::parseFile(filename, bencode::ParseLimits::strictLimits());
     if (!parsed->isDict()) {
         throw std::runtime_error("Invalid torrent file: root must be a dictionary");
     }
@@ -14,6 +28,7 @@ TorrentFile::TorrentFile(const std::string& filename) {
     
     // Parse announce URLs
     parseAnnounceUrls(dict);
+    parseWebSeeds(dict);
     
     // Parse info dictionary
     auto it = dict.find("info");
@@ -54,6 +69,27 @@ void TorrentFile::parseAnnounceUrls(const bencode::BencodeDict& dict) {
     }
 }
 
+void TorrentFile::parseWebSeeds(const bencode::BencodeDict& dict) {
+    // url-list is either a single URL or a list of them
+    auto url_list_it = dict.find("url-list");
+    if (url_list_it == dict.end()) {
+        return;
+    }
+    
+    const auto& url_list = url_list_it->second;
+    if (url_list->isString()) {
+        if (!url_list->asString().empty()) {
+            web_seeds_.push_back(url_list->asString());
+        }
+    } else if (url_list->isList()) {
+        for (const auto& url : url_list->asList()) {
+            if (url->isString() && !url->asString().empty()) {
+                web_seeds_.push_back(url->asString());
+            }
+        }
+    }
+}
+
 void TorrentFile::parseInfo(const bencode::BencodeDict& info_dict) {
     // Parse name
     if (auto name_it = info_dict.find("name"); name_it != info_dict.end()) {
@@ -72,6 +108,7 @@ void TorrentFile::parseInfo(const bencode::BencodeDict& info_dict) {
     
     // Parse files
     parseFiles(info_dict);
+    checkPathComponent(info_.name);
     
     // Calculate info hash
     info_.info_hash = calculateInfoHash(info_dict);
@@ -79,10 +116,12 @@ void TorrentFile::parseInfo(const bencode::BencodeDict& info_dict) {
 
 void TorrentFile::parseFiles(const bencode::BencodeDict& info_dict) {
     info_.total_length = 0;
+    info_.multi_file = false;
     
     // Handle both single file and multiple files
     if (auto files_it = info_dict.find("files"); files_it != info_dict.end()) {
         // Multiple files
+        info_.multi_file = true;
         const auto& files = files_it->second->asList();
         size_t offset = 0;
         
@@ -95,11 +134,15 @@ void TorrentFile::parseFiles(const bencode::BencodeDict& info_dict) {
                 const auto& path_list = path_it->second->asList();
                 std::stringstream path_ss;
                 for (size_t i = 0; i < path_list.size(); ++i) {
+                    checkPathComponent(path_list[i]->asString());
                     if (i > 0) path_ss << "/";
                     path_ss << path_list[i]->asString();
                 }
                 file_info.path = path_ss.str();
             }
+            if (file_info.path.empty()) {
+                throw std::runtime_error("Invalid torrent file: file without a path");
+            }
             
             // Parse file length
             if (auto length_it = file_dict.find("length"); length_it != file_dict.end()) {
@@ -150,4 +193,53 @@ std::string TorrentFile::getPieceHash(size_t index) const {
         throw std::out_of_range("Piece index out of range");
     }
     return info_.pieces.substr(index * 20, 20);
-} 
\ No newline at end of file
+}
+
+size_t TorrentFile::getPieceSize(size_t index) const {
+    if (index >= getNumPieces()) {
+        throw std::out_of_range("Piece index out of range");
+    }
+    size_t start = index * info_.piece_length;
+    return std::min(info_.piece_length, info_.total_length - start);
+}
+
+PieceRange TorrentFile::getPieceRange(size_t file_index, size_t offset, size_t length) const {
+    if (file_index >= info_.files.size()) {
+        throw std::out_of_range("File index out of range");
+    }
+    const auto& file = info_.files[file_index];
+    if (offset > file.length || length > file.length - offset) {
+        throw std::out_of_range("Byte range exceeds file length");
+    }
+    if (length == 0 || info_.piece_length == 0) {
+        return {0, 0};
+    }
+    
+    size_t start = file.offset + offset;
+    size_t end = start + length;
+    return {start / info_.piece_length, (end - 1) / info_.piece_length + 1};
+}
+
+size_t TorrentFile::getFileIndexAt(uint64_t offset) const {
+    if (offset >= info_.total_length) {
+        throw std::out_of_range("Offset exceeds torrent length");
+    }
+    
+    // Files are laid out back to back, so the last file starting at or
+    // before the offset holds it (zero-length files sort before their
+    // successor and are skipped this way)
+    auto it = std::upper_bound(info_.files.begin(), info_.files.end(), offset,
+                               [](uint64_t value, const FileInfo& file) { return value < file.offset; });
+    return static_cast<size_t>(it - info_.files.begin()) - 1;
+}
+
+std::string TorrentFile::getFilePath(size_t file_index, const std::string& download_dir) const {
+    if (file_index >= info_.files.size()) {
+        throw std::out_of_range("File index out of range");
+    }
+    std::string path = download_dir + "/";
+    if (info_.multi_file) {
+        path += info_.name + "/";
+    }
+    return path + info_.files[file_index].path;
+}
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "logger.hpp"
 #include <sstream>
 #include <iomanip>
+#include <arpa/inet.h>
 
 TrackerClient::TrackerClient() {
     curl_ = curl_easy_init();
@@ -240,6 +241,25 @@ std::vector<Peer> TrackerClient::parseCompactPeers(const std::string& peers_str)
     return peers;
 }
 
+std::string TrackerClient::encodeCompactPeers(const std::vector<Peer>& peers) {
+    std::string result;
+    result.reserve(peers.size() * 6);
+    
+    for (const auto& peer : peers) {
+        // Compact format only carries IPv4 addresses
+        in_addr addr;
+        if (inet_pton(AF_INET, peer.ip.c_str(), &addr) != 1) {
+            continue;
+        }
+        
+        result.append(reinterpret_cast<const char*>(&addr.s_addr), 4);
+        result += static_cast<char>((peer.port >> 8) & 0xff);
+        result += static_cast<char>(peer.port & 0xff);
+    }
+    
+    return result;
+}
+
 std::vector<Peer> TrackerClient::parseBencodedPeers(const std::string& peers_str) {
     std::vector<Peer> peers;
     auto parsed = bencode::BencodeParser::parse(peers_str);
@@ -0,0 +1,266 @@
+#include "web_seed.hpp"
+#include "tracker_client.hpp"
+#include "logger.hpp"
+#include <openssl/sha.h>
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+
+WebSeedClient::WebSeedClient(const TorrentFile& torrent,
+                             PieceStorage& storage,
+                             PiecePicker& picker,
+                             const std::vector<std::string>& urls,
+                             size_t connections_per_seed)
+    : torrent_(torrent),
+      storage_(storage),
+      picker_(picker),
+      multi_(curl_multi_init()) {
+    if (!multi_) {
+        throw std::runtime_error("Failed to initialize CURL multi handle");
+    }
+    curl_multi_setopt(multi_, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(connections_per_seed));
+    
+    for (const auto& url : urls) {
+        seeds_.push_back({url, 0, std::vector<bool>(torrent.getNumPieces(), true),
+                          std::vector<uint8_t>(torrent.getNumPieces(), 0)});
+    }
+    
+    for (size_t seed = 0; seed < seeds_.size(); ++seed) {
+        for (size_t i = 0; i < connections_per_seed; ++i) {
+            auto connection = std::make_unique<Connection>();
+            connection->handle = curl_easy_init();
+            if (!connection->handle) {
+                throw std::runtime_error("Failed to initialize CURL");
+            }
+            connection->seed = seed;
+            
+            // The handle is reused for every request so the connection stays alive
+            curl_easy_setopt(connection->handle, CURLOPT_WRITEFUNCTION, writeCallback);
+            curl_easy_setopt(connection->handle, CURLOPT_WRITEDATA, connection.get());
+            curl_easy_setopt(connection->handle, CURLOPT_PRIVATE, connection.get());
+            curl_easy_setopt(connection->handle, CURLOPT_FOLLOWLOCATION, 1L);
+            curl_easy_setopt(connection->handle, CURLOPT_TCP_KEEPALIVE, 1L);
+            // A stalled transfer ends with an error instead of holding run()
+            curl_easy_setopt(connection->handle, CURLOPT_LOW_SPEED_LIMIT, STALL_BYTES_PER_SECOND);
+            connections_.push_back(std::move(connection));
+        }
+    }
+    setStallTimeout(DEFAULT_STALL_TIMEOUT);
+}
+
+WebSeedClient::~WebSeedClient() {
+    for (auto& connection : connections_) {
+        if (connection->piece) {
+            curl_multi_remove_handle(multi_, connection->handle);
+            picker_.releasePiece(*connection->piece);
+        }
+        curl_easy_cleanup(connection->handle);
+    }
+    curl_multi_cleanup(multi_);
+}
+
+void WebSeedClient::setStallTimeout(long seconds) {
+    stall_timeout_ = std::max(1L, seconds);
+    for (auto& connection : connections_) {
+        curl_easy_setopt(connection->handle, CURLOPT_CONNECTTIMEOUT, stall_timeout_);
+        curl_easy_setopt(connection->handle, CURLOPT_LOW_SPEED_TIME, stall_timeout_);
+    }
+}
+
+std::string WebSeedClient::buildFileUrl(const std::string& base_url, const TorrentInfo& info, size_t file_index) {
+    if (file_index >= info.files.size()) {
+        throw std::out_of_range("File index out of range");
+    }
+    
+    // A single-file seed URL without a trailing slash names the file itself
+    if (!info.multi_file && (base_url.empty() || base_url.back() != '/')) {
+        return base_url;
+    }
+    
+    std::string url = base_url;
+    if (url.back() != '/') {
+        url += '/';
+    }
+    url += TrackerClient::urlEncode(info.name);
+    if (info.multi_file) {
+        std::stringstream path(info.files[file_index].path);
+        std::string component;
+        while (std::getline(path, component, '/')) {
+            url += "/" + TrackerClient::urlEncode(component);
+        }
+    }
+    return url;
+}
+
+std::vector<WebSeedClient::Segment> WebSeedClient::mapPiece(size_t piece) const {
+    const auto& info = torrent_.getInfo();
+    uint64_t offset = static_cast<uint64_t>(piece) * info.piece_length;
+    size_t length = torrent_.getPieceSize(piece);
+    
+    std::vector<Segment> segments;
+    size_t piece_offset = 0;
+    for (size_t index = torrent_.getFileIndexAt(offset); length > 0 && index < info.files.size(); ++index) {
+        const auto& file = info.files[index];
+        uint64_t file_end = file.offset + file.length;
+        if (offset >= file_end) {
+            continue;
+        }
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(length, file_end - offset));
+        segments.push_back({index, offset - file.offset, chunk, piece_offset});
+        offset += chunk;
+        piece_offset += chunk;
+        length -= chunk;
+    }
+    return segments;
+}
+
+size_t WebSeedClient::writeCallback(char* data, size_t size, size_t nmemb, void* userp) {
+    auto* connection = static_cast<Connection*>(userp);
+    const Segment& segment = connection->segments[connection->next_segment];
+    size_t bytes = size * nmemb;
+    
+    // A server that ignores the Range header sends too much; abort the transfer
+    if (connection->received + bytes > segment.length) {
+        return 0;
+    }
+    std::copy(data, data + bytes, connection->data.begin() + segment.piece_offset + connection->received);
+    connection->received += bytes;
+    return bytes;
+}
+
+bool WebSeedClient::startPiece(Connection& connection) {
+    if (seeds_[connection.seed].failures >= MAX_SEED_FAILURES ||
+        stats_.pieces_verified + std::count_if(connections_.begin(), connections_.end(),
+                                               [](const auto& c) { return c->piece.has_value(); }) >= target_) {
+        return false;
+    }
+    
+    auto piece = picker_.reservePiece(seeds_[connection.seed].has);
+    if (!piece) {
+        return false;
+    }
+    
+    connection.piece = piece;
+    connection.segments = mapPiece(*piece);
+    connection.next_segment = 0;
+    connection.data.assign(torrent_.getPieceSize(*piece), '\0');
+    startSegment(connection);
+    return true;
+}
+
+void WebSeedClient::startSegment(Connection& connection) {
+    const Segment& segment = connection.segments[connection.next_segment];
+    std::string url = buildFileUrl(seeds_[connection.seed].url, torrent_.getInfo(), segment.file_index);
+    std::string range = std::to_string(segment.offset) + "-" + std::to_string(segment.offset + segment.length - 1);
+    
+    connection.received = 0;
+    curl_easy_setopt(connection.handle, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(connection.handle, CURLOPT_RANGE, range.c_str());
+    curl_multi_add_handle(multi_, connection.handle);
+    stats_.requests++;
+}
+
+void WebSeedClient::handleDone(Connection& connection, CURLcode result) {
+    curl_multi_remove_handle(multi_, connection.handle);
+    
+    const Segment& segment = connection.segments[connection.next_segment];
+    long status = 0;
+    curl_easy_getinfo(connection.handle, CURLINFO_RESPONSE_CODE, &status);
+    
+    // 200 is fine only when the range was the whole file
+    const auto& file = torrent_.getInfo().files[segment.file_index];
+    bool whole_file = segment.offset == 0 && segment.length == file.length;
+    bool ok = result == CURLE_OK && (status == 206 || (status == 200 && whole_file)) &&
+              connection.received == segment.length;
+    stats_.bytes_downloaded += connection.received;
+    
+    if (!ok) {
+        Logger::warning("Web seed request failed for " + seeds_[connection.seed].url + ": " +
+                        (result != CURLE_OK ? curl_easy_strerror(result) : "HTTP " + std::to_string(status)));
+        finishPiece(connection, false);
+        return;
+    }
+    
+    if (++connection.next_segment < connection.segments.size()) {
+        startSegment(connection);
+        return;
+    }
+    finishPiece(connection, true);
+}
+
+void WebSeedClient::finishPiece(Connection& connection, bool success) {
+    size_t piece = *connection.piece;
+    connection.piece.reset();
+    
+    if (!success) {
+        // Transfer errors count against the seed; the piece goes back to the picker
+        seeds_[connection.seed].failures++;
+        stats_.pieces_failed++;
+        picker_.releasePiece(piece);
+        return;
+    }
+    seeds_[connection.seed].failures = 0;
+    
+    unsigned char hash[SHA_DIGEST_LENGTH];
+    SHA1(reinterpret_cast<const unsigned char*>(connection.data.data()), connection.data.size(), hash);
+    if (torrent_.getPieceHash(piece) != std::string(reinterpret_cast<char*>(hash), SHA_DIGEST_LENGTH)) {
+        Logger::warning("Web seed piece " + std::to_string(piece) + " failed hash check");
+        stats_.pieces_failed++;
+        // Retry unless this seed keeps sending it corrupt; other seeds and
+        // peers may still deliver it either way
+        Seed& seed = seeds_[connection.seed];
+        if (++seed.attempts[piece] >= MAX_PIECE_ATTEMPTS) {
+            seed.has[piece] = false;
+        }
+        picker_.releasePiece(piece);
+        return;
+    }
+    
+    storage_.writePiece(piece, connection.data);
+    picker_.markHave(piece);
+    stats_.pieces_verified++;
+}
+
+size_t WebSeedClient::run(size_t max_pieces) {
+    auto start = std::chrono::steady_clock::now();
+    target_ = stats_.pieces_verified + std::min(max_pieces, std::numeric_limits<size_t>::max() - stats_.pieces_verified);
+    size_t verified_before = stats_.pieces_verified;
+    
+    // Idle connections are refilled after every round, since failed pieces
+    // return to the picker and can be taken by a connection to another seed
+    auto startIdle = [this] {
+        size_t active = 0;
+        for (auto& connection : connections_) {
+            if (connection->piece || startPiece(*connection)) {
+                active++;
+            }
+        }
+        return active;
+    };
+    
+    while (startIdle() > 0) {
+        int running = 0;
+        curl_multi_perform(multi_, &running);
+        
+        int queued = 0;
+        bool finished_any = false;
+        while (CURLMsg* msg = curl_multi_info_read(multi_, &queued)) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            Connection* connection = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &connection);
+            handleDone(*connection, msg->data.result);
+            finished_any = true;
+        }
+        
+        // Freshly queued requests need a perform call before there is anything to wait for
+        if (!finished_any) {
+            curl_multi_poll(multi_, nullptr, 0, 1000, nullptr);
+        }
+    }
+    
+    stats_.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats_.pieces_verified - verified_before;
+}
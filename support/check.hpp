@@ -0,0 +1,18 @@
+#pragma once
+
+// Minimal assertions for the test executables
+
+#include <cstdlib>
+#include <iostream>
+
+// Exit code that CTest treats as a skipped test
+constexpr int TEST_SKIPPED = 77;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: "      \
+                      << #condition << std::endl;                               \
+            std::exit(1);                                                       \
+        }                                                                       \
+    } while (0)
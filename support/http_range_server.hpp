@@ -0,0 +1,198 @@
+#pragma once
+
+// Loopback HTTP/1.1 server answering GET with Range from in-memory files,
+// over keep-alive connections. Stands in for a web seed in tests and
+// benchmarks.
+
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+
+namespace support {
+
+class HttpRangeServer {
+public:
+    // Maps URL paths such as "/name/dir/file" to file contents
+    explicit HttpRangeServer(std::map<std::string, std::string> files)
+        : files_(std::move(files)),
+          acceptor_(io_, boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)) {
+        accept_thread_ = std::thread([this] { acceptLoop(); });
+    }
+    
+    ~HttpRangeServer() {
+        stopping_ = true;
+        // Wake the blocking accept with a connection of our own
+        boost::system::error_code ec;
+        boost::asio::ip::tcp::socket wake(io_);
+        wake.connect(acceptor_.local_endpoint(), ec);
+        accept_thread_.join();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (int fd : open_sockets_) {
+                ::shutdown(fd, SHUT_RDWR);
+            }
+        }
+        for (auto& thread : connection_threads_) {
+            thread.join();
+        }
+    }
+    
+    std::string baseUrl() const {
+        return "http://127.0.0.1:" + std::to_string(acceptor_.local_endpoint().port()) + "/";
+    }
+    
+    // Flips a byte in every response for this path, to fake a bad seed
+    void corrupt(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        corrupt_.push_back(path);
+    }
+    
+    // Sends half of every response for this path, then nothing more until
+    // the client gives up, to fake a stalled seed
+    void stall(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stalled_.push_back(path);
+    }
+    
+    size_t getRequests() const { return requests_.load(); }
+    uint64_t getBytesServed() const { return bytes_served_.load(); }
+    size_t getConnections() const { return connections_.load(); }
+    
+    // First byte of every range requested per path
+    std::map<std::string, std::vector<uint64_t>> getRangeStarts() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return range_starts_;
+    }
+    
+private:
+    void acceptLoop() {
+        while (true) {
+            boost::asio::ip::tcp::socket socket(io_);
+            boost::system::error_code ec;
+            acceptor_.accept(socket, ec);
+            if (stopping_) {
+                return;
+            }
+            if (ec) {
+                continue;
+            }
+            connections_++;
+            std::lock_guard<std::mutex> lock(mutex_);
+            open_sockets_.push_back(socket.native_handle());
+            connection_threads_.emplace_back([this, s = std::move(socket)]() mutable {
+                serve(s);
+                // Forget the descriptor before it is closed and can be reused
+                std::lock_guard<std::mutex> lock(mutex_);
+                open_sockets_.erase(std::find(open_sockets_.begin(), open_sockets_.end(), s.native_handle()));
+            });
+        }
+    }
+    
+    void serve(boost::asio::ip::tcp::socket& socket) {
+        socket.set_option(boost::asio::ip::tcp::no_delay(true));
+        boost::asio::streambuf buffer;
+        boost::system::error_code ec;
+        while (true) {
+            size_t header_length = boost::asio::read_until(socket, buffer, "\r\n\r\n", ec);
+            if (ec) {
+                return;
+            }
+            std::string header(boost::asio::buffers_begin(buffer.data()),
+                               boost::asio::buffers_begin(buffer.data()) + header_length);
+            buffer.consume(header_length);
+            if (!respond(socket, header)) {
+                return;
+            }
+        }
+    }
+    
+    bool respond(boost::asio::ip::tcp::socket& socket, const std::string& header) {
+        std::istringstream stream(header);
+        std::string method;
+        std::string path;
+        stream >> method >> path;
+        requests_++;
+        
+        auto file = files_.find(path);
+        if (method != "GET" || file == files_.end()) {
+            return send(socket, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n", {});
+        }
+        const std::string& data = file->second;
+        
+        uint64_t first = 0;
+        uint64_t last = data.empty() ? 0 : data.size() - 1;
+        bool ranged = false;
+        size_t range_pos = header.find("Range: bytes=");
+        if (range_pos != std::string::npos) {
+            std::istringstream range(header.substr(range_pos + 13));
+            char dash;
+            range >> first >> dash >> last;
+            ranged = true;
+        }
+        if (first > last || last >= data.size()) {
+            return send(socket, "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Length: 0\r\n\r\n", {});
+        }
+        
+        std::string body = data.substr(first, last - first + 1);
+        bool stalled;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            range_starts_[path].push_back(first);
+            for (const auto& corrupt_path : corrupt_) {
+                if (corrupt_path == path && !body.empty()) {
+                    body[0] = static_cast<char>(~body[0]);
+                }
+            }
+            stalled = std::find(stalled_.begin(), stalled_.end(), path) != stalled_.end();
+        }
+        
+        std::string response = ranged ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+        if (ranged) {
+            response += "Content-Range: bytes " + std::to_string(first) + "-" + std::to_string(last) +
+                        "/" + std::to_string(data.size()) + "\r\n";
+        }
+        response += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+        if (stalled) {
+            send(socket, response, body.substr(0, body.size() / 2));
+            // Returns once the client hangs up or the server shuts down
+            char byte;
+            boost::system::error_code ec;
+            boost::asio::read(socket, boost::asio::buffer(&byte, 1), ec);
+            return false;
+        }
+        bytes_served_ += body.size();
+        return send(socket, response, body);
+    }
+    
+    bool send(boost::asio::ip::tcp::socket& socket, const std::string& header, const std::string& body) {
+        boost::system::error_code ec;
+        std::vector<boost::asio::const_buffer> buffers{boost::asio::buffer(header), boost::asio::buffer(body)};
+        boost::asio::write(socket, buffers, ec);
+        return !ec;
+    }
+    
+    std::map<std::string, std::string> files_;
+    boost::asio::io_context io_;
+    boost::asio::ip::tcp::acceptor acceptor_;
+    std::thread accept_thread_;
+    std::vector<std::thread> connection_threads_;
+    std::vector<int> open_sockets_;
+    std::vector<std::string> corrupt_;
+    std::vector<std::string> stalled_;
+    std::map<std::string, std::vector<uint64_t>> range_starts_;
+    mutable std::mutex mutex_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<size_t> requests_{0};
+    std::atomic<uint64_t> bytes_served_{0};
+    std::atomic<size_t> connections_{0};
+};
+
+} // namespace support
@@ -0,0 +1,134 @@
+#pragma once
+
+// Builds .torrent files with random content for benchmarks and tests
+
+#include "bencode_parser.hpp"
+#include <openssl/sha.h>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace support {
+
+struct SyntheticTorrent {
+    std::string torrent_path;
+    std::string name;
+    std::string data;  // Content of all files back to back
+    std::vector<std::pair<std::string, size_t>> files;
+    bool multi_file;
+    
+    // Content of each file keyed by its URL path below a web seed root
+    std::map<std::string, std::string> urlPaths() const {
+        std::map<std::string, std::string> result;
+        size_t offset = 0;
+        for (const auto& [path, length] : files) {
+            result[multi_file ? "/" + name + "/" + path : "/" + name] = data.substr(offset, length);
+            offset += length;
+        }
+        return result;
+    }
+    
+    // Writes the content laid out as a client would store it under dir
+    void writeFiles(const std::string& dir) const {
+        size_t offset = 0;
+        for (const auto& [path, length] : files) {
+            std::filesystem::path file_path = multi_file ? std::filesystem::path(dir) / name / path
+                                                         : std::filesystem::path(dir) / name;
+            std::filesystem::create_directories(file_path.parent_path());
+            std::ofstream out(file_path, std::ios::binary | std::ios::trunc);
+            out.write(data.data() + offset, static_cast<std::streamsize>(length));
+            offset += length;
+        }
+    }
+};
+
+inline std::shared_ptr<bencode::BencodeValue> makeString(const std::string& str) {
+    return std::make_shared<bencode::BencodeValue>(str);
+}
+
+inline std::shared_ptr<bencode::BencodeValue> makeInteger(int64_t value) {
+    return std::make_shared<bencode::BencodeValue>(bencode::BencodeInteger(value));
+}
+
+// A single entry in files makes a single-file torrent unless multi_file is set
+inline SyntheticTorrent makeSyntheticTorrent(const std::string& dir,
+                                             const std::string& name,
+                                             const std::vector<std::pair<std::string, size_t>>& files,
+                                             size_t piece_length,
+                                             bool multi_file = false,
+                                             const std::vector<std::string>& web_seeds = {},
+                                             uint32_t seed = 1) {
+    SyntheticTorrent torrent{"", name, "", files, multi_file || files.size() > 1};
+    
+    std::mt19937_64 rng(seed);
+    size_t total = 0;
+    for (const auto& file : files) {
+        total += file.second;
+    }
+    torrent.data.resize(total);
+    for (size_t i = 0; i < total; i += 8) {
+        uint64_t value = rng();
+        for (size_t j = 0; j < 8 && i + j < total; ++j) {
+            torrent.data[i + j] = static_cast<char>(value >> (j * 8));
+        }
+    }
+    
+    std::string pieces;
+    for (size_t offset = 0; offset < total; offset += piece_length) {
+        unsigned char hash[SHA_DIGEST_LENGTH];
+        size_t length = std::min(piece_length, total - offset);
+        SHA1(reinterpret_cast<const unsigned char*>(torrent.data.data() + offset), length, hash);
+        pieces.append(reinterpret_cast<char*>(hash), SHA_DIGEST_LENGTH);
+    }
+    
+    bencode::BencodeDict info;
+    info["name"] = makeString(name);
+    info["piece length"] = makeInteger(static_cast<int64_t>(piece_length));
+    info["pieces"] = makeString(pieces);
+    if (torrent.multi_file) {
+        bencode::BencodeList file_list;
+        for (const auto& [path, length] : files) {
+            bencode::BencodeList components;
+            std::string component;
+            for (char c : path + "/") {
+                if (c == '/') {
+                    components.push_back(makeString(component));
+                    component.clear();
+                } else {
+                    component += c;
+                }
+            }
+            bencode::BencodeDict file;
+            file["length"] = makeInteger(static_cast<int64_t>(length));
+            file["path"] = std::make_shared<bencode::BencodeValue>(components);
+            file_list.push_back(std::make_shared<bencode::BencodeValue>(file));
+        }
+        info["files"] = std::make_shared<bencode::BencodeValue>(file_list);
+    } else {
+        info["length"] = makeInteger(static_cast<int64_t>(total));
+    }
+    
+    bencode::BencodeDict root;
+    root["announce"] = makeString("http://127.0.0.1:1/announce");
+    root["info"] = std::make_shared<bencode::BencodeValue>(info);
+    if (!web_seeds.empty()) {
+        bencode::BencodeList urls;
+        for (const auto& url : web_seeds) {
+            urls.push_back(makeString(url));
+        }
+        root["url-list"] = std::make_shared<bencode::BencodeValue>(urls);
+    }
+    
+    std::filesystem::create_directories(dir);
+    torrent.torrent_path = (std::filesystem::path(dir) / (name + ".torrent")).string();
+    std::ofstream out(torrent.torrent_path, std::ios::binary | std::ios::trunc);
+    std::string encoded = bencode::BencodeValue(root).encode();
+    out.write(encoded.data(), static_cast<std::streamsize>(encoded.size()));
+    return torrent;
+}
+
+} // namespace support
@@ -0,0 +1,87 @@
+// BufferPool under multi-threaded churn must never allocate more than
+// max_blocks, even with blocks parked in the caches of live threads, and
+// acquire() must block once every block is in use.
+
+#include "check.hpp"
+#include "buffer_pool.hpp"
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t MAX_BLOCKS = 8;
+constexpr size_t NUM_THREADS = 8;
+constexpr size_t ITERATIONS = 20000;
+
+void testCapUnderChurn() {
+    BufferPool pool(1024, MAX_BLOCKS, 4);
+    std::atomic<size_t> finished{0};
+    std::atomic<bool> exit{false};
+    
+    // Workers stay alive after churning so their caches keep their blocks
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < NUM_THREADS; ++t) {
+        workers.emplace_back([&, t] {
+            for (size_t i = 0; i < ITERATIONS; ++i) {
+                BufferHandle block = pool.acquire();
+                block.data()[0] = static_cast<char>(t);
+                // A second block only if one is free; waiting for it while
+                // holding the first could deadlock all workers
+                if ((i + t) % 3 == 0) {
+                    auto extra = pool.tryAcquire();
+                }
+            }
+            finished++;
+            while (!exit) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    }
+    while (finished < NUM_THREADS) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    
+    BufferPoolStats stats = pool.getStats();
+    CHECK(stats.blocks_allocated <= MAX_BLOCKS);
+    CHECK(stats.peak_in_use <= MAX_BLOCKS);
+    CHECK(stats.blocks_in_use == 0);
+    
+    // Every block can still be had, taking back what the idle caches hold
+    std::vector<BufferHandle> all;
+    for (size_t i = 0; i < MAX_BLOCKS; ++i) {
+        auto handle = pool.acquireFor(std::chrono::seconds(5));
+        CHECK(handle.has_value());
+        all.push_back(std::move(*handle));
+    }
+    CHECK(pool.getStats().blocks_allocated <= MAX_BLOCKS);
+    CHECK(!pool.tryAcquire());
+    
+    // With all blocks out, acquire() waits until one comes back
+    std::atomic<bool> acquired{false};
+    std::thread waiter([&] {
+        BufferHandle handle = pool.acquire();
+        acquired = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(!acquired);
+    all.pop_back();
+    waiter.join();
+    CHECK(acquired);
+    CHECK(pool.getStats().backpressure_waits > 0);
+    CHECK(pool.getStats().blocks_allocated <= MAX_BLOCKS);
+    
+    exit = true;
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+} // namespace
+
+int main() {
+    testCapUnderChurn();
+    return 0;
+}
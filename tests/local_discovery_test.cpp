@@ -0,0 +1,112 @@
+// Several LocalServiceDiscovery instances on one host share a multicast
+// group over loopback and must each learn about all the others, but not
+// about themselves.
+
+#include "check.hpp"
+#include "local_discovery.hpp"
+#include <chrono>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t NUM_CLIENTS = 3;
+constexpr const char* INFO_HASH = "0123456789abcdef0123456789abcdef01234567";
+
+void testParseAnnounce() {
+    std::string message = LocalServiceDiscovery::buildAnnounce(
+        "239.192.152.143:6771", 6881, {INFO_HASH}, "c00kie");
+    auto announce = LocalServiceDiscovery::parseAnnounce(message);
+    CHECK(announce);
+    CHECK(announce->port == 6881);
+    CHECK(announce->info_hashes == std::vector<std::string>{INFO_HASH});
+    CHECK(announce->cookie == "c00kie");
+    
+    CHECK(!LocalServiceDiscovery::parseAnnounce("GET / HTTP/1.1\r\n\r\n"));
+    CHECK(!LocalServiceDiscovery::parseAnnounce(
+        LocalServiceDiscovery::buildAnnounce("h", 0, {INFO_HASH}, "")));
+    CHECK(!LocalServiceDiscovery::parseAnnounce(
+        LocalServiceDiscovery::buildAnnounce("h", 6881, {"nothex"}, "")));
+    // Bytes from the network can be anything, including ones above 0x7f
+    CHECK(!LocalServiceDiscovery::parseAnnounce(
+        LocalServiceDiscovery::buildAnnounce("h", 6881, {std::string(40, '\xe9')}, "")));
+}
+
+int testMultipleClients() {
+    // A random port keeps parallel runs and real clients out of the group
+    std::random_device rd;
+    uint16_t group_port = static_cast<uint16_t>(20000 + rd() % 20000);
+    
+    boost::asio::io_context io;
+    std::vector<std::unique_ptr<LocalServiceDiscovery>> clients;
+    std::map<uint16_t, std::set<uint16_t>> seen;  // Listen port -> announced ports
+    try {
+        for (size_t i = 0; i < NUM_CLIENTS; ++i) {
+            uint16_t listen_port = static_cast<uint16_t>(7000 + i);
+            clients.push_back(std::make_unique<LocalServiceDiscovery>(
+                io, listen_port,
+                [&seen, listen_port](const std::string& info_hash, const Peer& peer) {
+                    CHECK(info_hash == INFO_HASH);
+                    seen[listen_port].insert(peer.port);
+                },
+                LocalServiceDiscovery::MULTICAST_ADDRESS, group_port));
+        }
+        for (auto& client : clients) {
+            client->announce({INFO_HASH});
+        }
+    } catch (const boost::system::system_error& e) {
+        std::cerr << "Multicast unavailable: " << e.what() << std::endl;
+        return TEST_SKIPPED;
+    }
+    
+    // Looks up without inserting, so seen stays empty until a packet arrives
+    auto all_seen = [&seen] {
+        for (size_t i = 0; i < NUM_CLIENTS; ++i) {
+            auto it = seen.find(static_cast<uint16_t>(7000 + i));
+            if (it == seen.end() || it->second.size() < NUM_CLIENTS - 1) {
+                return false;
+            }
+        }
+        return true;
+    };
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!all_seen() && std::chrono::steady_clock::now() < deadline) {
+        io.run_for(std::chrono::milliseconds(50));
+    }
+    if (seen.empty()) {
+        // Nothing looped back at all: no multicast route on this host
+        std::cerr << "No multicast loopback" << std::endl;
+        return TEST_SKIPPED;
+    }
+    
+    for (size_t i = 0; i < NUM_CLIENTS; ++i) {
+        uint16_t listen_port = static_cast<uint16_t>(7000 + i);
+        std::set<uint16_t> expected;
+        for (size_t j = 0; j < NUM_CLIENTS; ++j) {
+            if (j != i) {
+                expected.insert(static_cast<uint16_t>(7000 + j));
+            }
+        }
+        CHECK(seen[listen_port] == expected);
+    }
+    
+    // Closing must stop every pending operation so the loop runs dry
+    for (auto& client : clients) {
+        client->close();
+    }
+    io.restart();
+    io.run_for(std::chrono::seconds(2));
+    CHECK(io.stopped());
+    return 0;
+}
+
+} // namespace
+
+int main() {
+    testParseAnnounce();
+    return testMultipleClients();
+}
@@ -0,0 +1,255 @@
+// RC4 against published test vectors, the DH key exchange, and the MSE
+// handshake between two threads over a socket pair, followed by payload.
+
+#include "check.hpp"
+#include "mse.hpp"
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+std::string fromHex(const std::string& hex) {
+    std::string bytes;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+        bytes.push_back(static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+    }
+    return bytes;
+}
+
+std::string rc4(const std::string& key, std::string data) {
+    mse::Rc4Cipher cipher(reinterpret_cast<const unsigned char*>(key.data()), key.size());
+    cipher.apply(data.data(), data.size());
+    return data;
+}
+
+void testRc4KnownAnswers() {
+    CHECK(rc4("Key", "Plaintext") == fromHex("BBF316E8D940AF0AD3"));
+    CHECK(rc4("Wiki", "pedia") == fromHex("1021BF0420"));
+    CHECK(rc4("Secret", "Attack at dawn") == fromHex("45A01F645FC35B383552544B9BF5"));
+    
+    // Discarding keystream is the same as encrypting and throwing it away
+    std::string key = "Key";
+    mse::Rc4Cipher skipped(reinterpret_cast<const unsigned char*>(key.data()), key.size());
+    skipped.discard(4);
+    std::string tail = "ntext";
+    skipped.apply(tail.data(), tail.size());
+    CHECK(tail == fromHex("BBF316E8D940AF0AD3").substr(4));
+}
+
+bool rejects(const mse::KeyExchange& keys, const std::string& public_key) {
+    try {
+        keys.computeSecret(public_key);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+void testKeyExchange() {
+    mse::KeyExchange a;
+    mse::KeyExchange b;
+    CHECK(a.getPublicKey().size() == mse::KEY_SIZE);
+    CHECK(a.getPublicKey() != b.getPublicKey());
+    std::string secret = a.computeSecret(b.getPublicKey());
+    CHECK(secret.size() == mse::KEY_SIZE);
+    CHECK(secret == b.computeSecret(a.getPublicKey()));
+    
+    // 0, 1 and P-1 would force a known secret
+    std::string one(mse::KEY_SIZE, '\0');
+    one.back() = 1;
+    std::string p_minus_one = fromHex(
+        "FFFFFFFFFFFFFFFFC90FDAA22168C234C4C6628B80DC1CD129024E088A67CC74"
+        "020BBEA63B139B22514A08798E3404DDEF9519B3CD3A431B302B0A6DF25F1437"
+        "4FE1356D6D51C245E485B576625E7EC6F44C42E9A63A36210000000000090562");
+    CHECK(rejects(a, std::string(mse::KEY_SIZE, '\0')));
+    CHECK(rejects(a, one));
+    CHECK(rejects(a, p_minus_one));
+    CHECK(rejects(a, std::string(mse::KEY_SIZE, '\xff')));
+    CHECK(rejects(a, b.getPublicKey().substr(1)));
+}
+
+void testCipherStreamPair() {
+    mse::KeyExchange a;
+    mse::KeyExchange b;
+    std::string secret = a.computeSecret(b.getPublicKey());
+    const std::string skey(20, '\x42');
+    mse::CipherStream initiator(secret, skey, true);
+    mse::CipherStream responder(secret, skey, false);
+    
+    std::string plain(5000, '\0');
+    for (size_t i = 0; i < plain.size(); ++i) {
+        plain[i] = static_cast<char>(i * 31);
+    }
+    
+    // keyA and keyB differ, so the two directions encrypt differently
+    std::string to_responder = plain;
+    std::string to_initiator = plain;
+    initiator.encrypt(to_responder.data(), to_responder.size());
+    responder.encrypt(to_initiator.data(), to_initiator.size());
+    CHECK(to_responder != plain);
+    CHECK(to_responder != to_initiator);
+    
+    // Decryption may split the stream differently from encryption
+    iovec halves[2] = {{to_responder.data(), 1234}, {to_responder.data() + 1234, to_responder.size() - 1234}};
+    responder.decrypt(halves, 2);
+    initiator.decrypt(to_initiator.data(), 17);
+    initiator.decrypt(to_initiator.data() + 17, to_initiator.size() - 17);
+    CHECK(to_responder == plain);
+    CHECK(to_initiator == plain);
+}
+
+struct SocketPair {
+    int initiator = -1;
+    int responder = -1;
+    
+    SocketPair() {
+        int fds[2];
+        CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        initiator = fds[0];
+        responder = fds[1];
+    }
+    
+    ~SocketPair() {
+        closeInitiator();
+        closeResponder();
+    }
+    
+    void closeInitiator() {
+        if (initiator >= 0) {
+            ::close(initiator);
+            initiator = -1;
+        }
+    }
+    
+    void closeResponder() {
+        if (responder >= 0) {
+            ::close(responder);
+            responder = -1;
+        }
+    }
+};
+
+void sendAll(int fd, std::string data) {
+    CHECK(::send(fd, data.data(), data.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(data.size()));
+}
+
+std::string receiveExactly(int fd, size_t length) {
+    std::string data(length, '\0');
+    CHECK(::recv(fd, data.data(), length, MSG_WAITALL) == static_cast<ssize_t>(length));
+    return data;
+}
+
+void testHandshake(uint32_t provide, uint32_t allowed, mse::CryptoMethod expected) {
+    const std::string skey(20, '\x17');
+    const std::string other(20, '\x99');
+    const std::string initial_payload = "\x13" "BitTorrent protocol";
+    const std::string payload = "payload right behind the handshake";
+    
+    SocketPair sockets;
+    mse::HandshakeResult responded{};
+    std::thread responder([&] {
+        responded = mse::respondHandshake(sockets.responder, {other, skey}, allowed);
+        // Sent straight away, so reading past the handshake would swallow it
+        std::string data = payload;
+        if (responded.cipher) {
+            responded.cipher->encrypt(data.data(), data.size());
+        }
+        sendAll(sockets.responder, data);
+    });
+    mse::HandshakeResult initiated = mse::initiateHandshake(sockets.initiator, skey, provide, initial_payload);
+    responder.join();
+    
+    CHECK(initiated.method == expected);
+    CHECK(responded.method == expected);
+    CHECK(responded.skey == skey);
+    CHECK(responded.initial_payload == initial_payload);
+    CHECK(initiated.cipher.has_value() == (expected == mse::CRYPTO_RC4));
+    CHECK(responded.cipher.has_value() == (expected == mse::CRYPTO_RC4));
+    
+    std::string received = receiveExactly(sockets.initiator, payload.size());
+    if (initiated.cipher) {
+        CHECK(received != payload);
+        initiated.cipher->decrypt(received.data(), received.size());
+    }
+    CHECK(received == payload);
+    
+    // And the other way
+    std::string data = payload;
+    if (initiated.cipher) {
+        initiated.cipher->encrypt(data.data(), data.size());
+    }
+    sendAll(sockets.initiator, data);
+    received = receiveExactly(sockets.responder, payload.size());
+    if (responded.cipher) {
+        responded.cipher->decrypt(received.data(), received.size());
+    }
+    CHECK(received == payload);
+}
+
+// Both sides must give up: the responder on what it was sent, the
+// initiator when the responder hangs up
+void testHandshakeFails(const std::string& skey, uint32_t provide, uint32_t allowed) {
+    const std::string known(20, '\x17');
+    SocketPair sockets;
+    bool responder_threw = false;
+    std::thread responder([&] {
+        try {
+            mse::respondHandshake(sockets.responder, {known}, allowed);
+        } catch (const std::runtime_error&) {
+            responder_threw = true;
+        }
+        sockets.closeResponder();
+    });
+    bool initiator_threw = false;
+    try {
+        mse::initiateHandshake(sockets.initiator, skey, provide);
+    } catch (const std::runtime_error&) {
+        initiator_threw = true;
+    }
+    responder.join();
+    CHECK(responder_threw);
+    CHECK(initiator_threw);
+}
+
+// Random bytes instead of a handshake: the responder stops scanning for
+// HASH('req1', S) after the longest padding allowed
+void testGarbageRejected() {
+    SocketPair sockets;
+    std::thread initiator([&] {
+        mse::KeyExchange keys;
+        sendAll(sockets.initiator, keys.getPublicKey() + std::string(mse::MAX_PADDING + 100, '\x5a'));
+    });
+    bool threw = false;
+    try {
+        mse::respondHandshake(sockets.responder, {std::string(20, '\x17')}, mse::CRYPTO_RC4);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    initiator.join();
+    CHECK(threw);
+}
+
+} // namespace
+
+int main() {
+    testRc4KnownAnswers();
+    testKeyExchange();
+    testCipherStreamPair();
+    
+    // Padding lengths are random, so run the handshake a few times
+    for (int i = 0; i < 10; ++i) {
+        testHandshake(mse::CRYPTO_RC4 | mse::CRYPTO_PLAINTEXT, mse::CRYPTO_RC4 | mse::CRYPTO_PLAINTEXT,
+                      mse::CRYPTO_RC4);
+    }
+    testHandshake(mse::CRYPTO_PLAINTEXT, mse::CRYPTO_RC4 | mse::CRYPTO_PLAINTEXT, mse::CRYPTO_PLAINTEXT);
+    testHandshake(mse::CRYPTO_RC4 | mse::CRYPTO_PLAINTEXT, mse::CRYPTO_PLAINTEXT, mse::CRYPTO_PLAINTEXT);
+    
+    testHandshakeFails(std::string(20, '\x01'), mse::CRYPTO_RC4, mse::CRYPTO_RC4);
+    testHandshakeFails(std::string(20, '\x17'), mse::CRYPTO_PLAINTEXT, mse::CRYPTO_RC4);
+    testGarbageRejected();
+    return 0;
+}
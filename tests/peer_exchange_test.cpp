@@ -0,0 +1,136 @@
+// PEX messages survive an encode/decode round trip and malformed ones are
+// rejected with runtime_error; PeerList applies the per-source rate limit,
+// the 50 peer cap and tracks what each peer was last sent.
+
+#include "check.hpp"
+#include "peer_exchange.hpp"
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool rejects(const std::string& payload) {
+    try {
+        PeerExchange::decode(payload);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+std::vector<Peer> makePeers(size_t count, size_t first = 0) {
+    std::vector<Peer> peers;
+    for (size_t i = first; i < first + count; ++i) {
+        peers.push_back({"10.0." + std::to_string(i / 250) + "." + std::to_string(i % 250 + 1),
+                         static_cast<uint16_t>(6881 + i)});
+    }
+    return peers;
+}
+
+bool samePeers(const std::vector<Peer>& a, const std::vector<Peer>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].ip != b[i].ip || a[i].port != b[i].port) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void testRoundTrip() {
+    PexMessage message;
+    message.added = makePeers(3);
+    message.added_flags = {PEX_SEED, PEX_PREFERS_ENCRYPTION | PEX_REACHABLE, 0};
+    message.dropped = makePeers(2, 100);
+    
+    PexMessage decoded = PeerExchange::decode(PeerExchange::encode(message));
+    CHECK(samePeers(decoded.added, message.added));
+    CHECK(decoded.added_flags == message.added_flags);
+    CHECK(samePeers(decoded.dropped, message.dropped));
+    
+    // Missing flags default to none, one per added peer
+    using namespace std::string_literals;
+    decoded = PeerExchange::decode("d5:added6:\x0a\x00\x00\x01\x1a\xe1" "e"s);
+    CHECK(decoded.added.size() == 1);
+    CHECK(decoded.added[0].ip == "10.0.0.1" && decoded.added[0].port == 6881);
+    CHECK(decoded.added_flags == std::vector<uint8_t>{0});
+    CHECK(decoded.dropped.empty());
+}
+
+void testMalformed() {
+    CHECK(rejects("li1ee"));
+    CHECK(rejects("d5:addedi1ee"));
+    CHECK(rejects("d5:addedle7:added.f0:e"));
+    CHECK(rejects("d7:droppedd1:ai1eee"));
+    CHECK(rejects("d7:added.fi0ee"));
+    CHECK(rejects("d5:added5:abcdee"));
+}
+
+void testRateLimit() {
+    PeerList list(1000, std::chrono::seconds(60));
+    auto now = PeerList::Clock::now();
+    PexMessage first{makePeers(5), {}, {}};
+    PexMessage second{makePeers(5, 5), {}, {}};
+    
+    CHECK(list.mergePex("a", first, now) == 5);
+    CHECK(list.mergePex("a", second, now + std::chrono::seconds(30)) == 0);
+    // Each source has its own budget
+    CHECK(list.mergePex("b", second, now + std::chrono::seconds(30)) == 5);
+    CHECK(list.mergePex("a", PexMessage{makePeers(1, 20), {}, {}}, now + std::chrono::seconds(61)) == 1);
+    CHECK(list.size() == 11);
+}
+
+void testPexCap() {
+    PeerList list;
+    PexMessage flood{makePeers(80), {}, {}};
+    CHECK(list.mergePex("flooder", flood) == PeerList::MAX_PEX_PEERS);
+    CHECK(list.size() == PeerList::MAX_PEX_PEERS);
+    
+    // The overall limit holds for trusted sources too
+    PeerList small(10);
+    CHECK(small.add(makePeers(20)) == 10);
+    CHECK(small.size() == 10);
+}
+
+void testDelta() {
+    PeerList list;
+    list.add(makePeers(3));
+    
+    PexMessage delta = list.makeDelta("x");
+    CHECK(samePeers(delta.added, makePeers(3)));
+    CHECK(delta.added_flags.size() == 3);
+    CHECK(delta.dropped.empty());
+    
+    // Nothing changed since the last message to x, but y has seen nothing
+    delta = list.makeDelta("x");
+    CHECK(delta.added.empty() && delta.dropped.empty());
+    CHECK(list.makeDelta("y").added.size() == 3);
+    
+    list.remove(makePeers(1)[0]);
+    list.add(makePeers(1, 3));
+    delta = list.makeDelta("x");
+    CHECK(samePeers(delta.added, makePeers(1, 3)));
+    CHECK(samePeers(delta.dropped, makePeers(1)));
+    
+    // Each message carries at most 50 additions; the rest follow later
+    PeerList big;
+    big.add(makePeers(120));
+    CHECK(big.makeDelta("z").added.size() == PeerList::MAX_PEX_PEERS);
+    CHECK(big.makeDelta("z").added.size() == PeerList::MAX_PEX_PEERS);
+    CHECK(big.makeDelta("z").added.size() == 20);
+}
+
+} // namespace
+
+int main() {
+    testRoundTrip();
+    testMalformed();
+    testRateLimit();
+    testPexCap();
+    testDelta();
+    return 0;
+}
@@ -0,0 +1,217 @@
+// PieceStorage with skipped files: pieces kept in the partfile move to the
+// real file when it becomes wanted, files are opened lazily within the fd
+// limit, skipped files can still be streamed, a seek withdraws the
+// stream's earlier deadlines, and checking pieces creates no files.
+
+#include "check.hpp"
+#include "synthetic_torrent.hpp"
+#include "file_selection.hpp"
+#include "file_stream.hpp"
+#include "piece_picker.hpp"
+#include "piece_storage.hpp"
+#include "torrent_file.hpp"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t PIECE_LENGTH = 16 * 1024;
+
+std::string testDir(const std::string& name) {
+    auto dir = std::filesystem::temp_directory_path() / ("bittorrent_piece_storage_test_" + name);
+    std::filesystem::remove_all(dir);
+    return dir.string();
+}
+
+void writeAll(PieceStorage& storage, const TorrentFile& torrent, const std::string& data,
+              const std::vector<size_t>& pieces) {
+    for (size_t piece : pieces) {
+        storage.writePiece(piece, data.substr(piece * PIECE_LENGTH, torrent.getPieceSize(piece)));
+    }
+}
+
+void testSkippedPiecesMoveWhenWanted() {
+    std::string dir = testDir("move");
+    // The middle file spans many whole pieces
+    auto synthetic = support::makeSyntheticTorrent(
+        dir, "move", {{"a.bin", 10000}, {"b.bin", 10 * PIECE_LENGTH}, {"c.bin", 7000}}, PIECE_LENGTH);
+    TorrentFile torrent(synthetic.torrent_path);
+    FileSelection selection(torrent);
+    selection.setPriority(1, DownloadPriority::SKIP);
+    
+    std::vector<size_t> all(torrent.getNumPieces());
+    for (size_t i = 0; i < all.size(); ++i) {
+        all[i] = i;
+    }
+    
+    {
+        PieceStorage storage(torrent, dir + "/download", &selection);
+        // Every piece is written, as deadlines may fetch skipped ones too
+        writeAll(storage, torrent, synthetic.data, all);
+        CHECK(!std::filesystem::exists(torrent.getFilePath(1, dir + "/download")));
+        for (size_t piece : all) {
+            CHECK(storage.verifyPiece(piece));
+        }
+        
+        selection.setPriority(1, DownloadPriority::NORMAL);
+        storage.updateFileSelection();
+        for (size_t piece : all) {
+            CHECK(storage.verifyPiece(piece));
+        }
+    }
+    
+    // Everything lives in real files now, so a fresh storage that ignores
+    // the partfile sees the whole torrent
+    std::filesystem::remove(dir + "/download/.move.parts");
+    PieceStorage storage(torrent, dir + "/download");
+    for (size_t piece : all) {
+        CHECK(storage.verifyPiece(piece));
+    }
+    std::filesystem::remove_all(dir);
+}
+
+void testOpenFileLimit() {
+    std::string dir = testDir("limit");
+    std::vector<std::pair<std::string, size_t>> files;
+    for (size_t i = 0; i < 300; ++i) {
+        files.emplace_back("dir" + std::to_string(i % 7) + "/file" + std::to_string(i), 1000 + i * 37);
+    }
+    auto synthetic = support::makeSyntheticTorrent(dir, "limit", files, PIECE_LENGTH);
+    TorrentFile torrent(synthetic.torrent_path);
+    
+    PieceStorage storage(torrent, dir + "/download");
+    storage.setMaxOpenFiles(8);
+    CHECK(storage.getNumOpenFiles() == 0);
+    
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t piece = t; piece < torrent.getNumPieces(); piece += 4) {
+                writeAll(storage, torrent, synthetic.data, {piece});
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    CHECK(storage.getNumOpenFiles() <= 8);
+    for (size_t piece = 0; piece < torrent.getNumPieces(); ++piece) {
+        CHECK(storage.verifyPiece(piece));
+    }
+    CHECK(storage.getNumOpenFiles() <= 8);
+    std::filesystem::remove_all(dir);
+}
+
+void testStreamSkippedFile() {
+    std::string dir = testDir("stream");
+    auto synthetic = support::makeSyntheticTorrent(
+        dir, "stream", {{"a.bin", 3 * PIECE_LENGTH + 100}, {"b.bin", 5000}}, PIECE_LENGTH);
+    TorrentFile torrent(synthetic.torrent_path);
+    FileSelection selection(torrent);
+    selection.setPriority(0, DownloadPriority::SKIP);
+    
+    PieceStorage storage(torrent, dir + "/download", &selection);
+    PiecePicker picker(torrent.getNumPieces());
+    for (size_t piece = 0; piece < torrent.getNumPieces(); ++piece) {
+        writeAll(storage, torrent, synthetic.data, {piece});
+        picker.markHave(piece);
+    }
+    CHECK(!std::filesystem::exists(torrent.getFilePath(0, dir + "/download")));
+    
+    FileStream stream(torrent, picker, storage, 0);
+    std::string read(stream.size(), '\0');
+    size_t done = 0;
+    while (size_t n = stream.read(read.data() + done, 4096)) {
+        done += n;
+    }
+    CHECK(done == stream.size());
+    CHECK(read == synthetic.data.substr(0, stream.size()));
+    std::filesystem::remove_all(dir);
+}
+
+void testSeekClearsDeadlines() {
+    std::string dir = testDir("seek");
+    auto synthetic = support::makeSyntheticTorrent(dir, "seek.bin", {{"seek.bin", 10 * PIECE_LENGTH}}, PIECE_LENGTH);
+    TorrentFile torrent(synthetic.torrent_path);
+    PieceStorage storage(torrent, dir + "/download");
+    PiecePicker picker(torrent.getNumPieces());
+    writeAll(storage, torrent, synthetic.data, {0, 9});
+    picker.markHave(0);
+    picker.markHave(9);
+    
+    // Pieces 1-4 are common, so only deadlines can make them come first
+    std::vector<bool> all(torrent.getNumPieces(), true);
+    for (size_t piece = 1; piece <= 4; ++piece) {
+        picker.incrementAvailability(piece);
+        picker.incrementAvailability(piece);
+    }
+    for (size_t piece = 0; piece < torrent.getNumPieces(); ++piece) {
+        picker.incrementAvailability(piece);
+    }
+    
+    {
+        FileStream stream(torrent, picker, storage, 0);
+        stream.setReadAhead(4 * PIECE_LENGTH);
+        char byte;
+        CHECK(stream.read(&byte, 1) == 1);
+        CHECK(picker.pickPiece(all) == 1u);
+        
+        // Reading at the tail sets no deadline of its own
+        stream.seek(9 * PIECE_LENGTH);
+        CHECK(stream.read(&byte, 1) == 1);
+        auto picked = picker.pickPiece(all);
+        CHECK(picked && *picked >= 5 && *picked <= 8);
+        
+        stream.seek(0);
+        CHECK(stream.read(&byte, 1) == 1);
+        CHECK(picker.pickPiece(all) == 1u);
+    }
+    
+    // Closing the stream withdraws its deadlines too
+    auto picked = picker.pickPiece(all);
+    CHECK(picked && *picked >= 5 && *picked <= 8);
+    std::filesystem::remove_all(dir);
+}
+
+void testVerifyCreatesNothing() {
+    std::string dir = testDir("verify");
+    auto synthetic = support::makeSyntheticTorrent(
+        dir, "verify", {{"sub/a.bin", 2 * PIECE_LENGTH}, {"b.bin", PIECE_LENGTH + 500}}, PIECE_LENGTH);
+    TorrentFile torrent(synthetic.torrent_path);
+    std::string download = dir + "/download";
+    
+    PieceStorage storage(torrent, download);
+    for (size_t piece = 0; piece < torrent.getNumPieces(); ++piece) {
+        CHECK(!storage.verifyPiece(piece));
+    }
+    CHECK(std::filesystem::is_empty(download));
+    
+    // A file shorter than in the torrent is not extended by reads either
+    std::filesystem::path b_path = torrent.getFilePath(1, download);
+    std::filesystem::create_directories(b_path.parent_path());
+    std::ofstream(b_path) << "partial";
+    CHECK(!storage.verifyPiece(2));
+    CHECK(!storage.verifyPiece(3));
+    CHECK(std::filesystem::file_size(b_path) == 7);
+    
+    writeAll(storage, torrent, synthetic.data, {2});
+    CHECK(storage.verifyPiece(2));
+    CHECK(!storage.verifyPiece(3));
+    CHECK(std::filesystem::file_size(b_path) == PIECE_LENGTH + 500);
+    CHECK(!std::filesystem::exists(torrent.getFilePath(0, download)));
+    std::filesystem::remove_all(dir);
+}
+
+} // namespace
+
+int main() {
+    testSkippedPiecesMoveWhenWanted();
+    testOpenFileLimit();
+    testStreamSkippedFile();
+    testSeekClearsDeadlines();
+    testVerifyCreatesNothing();
+    return 0;
+}
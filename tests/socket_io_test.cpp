@@ -0,0 +1,86 @@
+// Every socket backend must deliver a stream split into requests of uneven
+// sizes intact and in order, and report a peer that hangs up.
+
+#include "check.hpp"
+#include "socket_io.hpp"
+#include <boost/asio.hpp>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using boost::asio::ip::tcp;
+
+struct Connection {
+    boost::asio::io_context io;
+    tcp::socket out{io};
+    tcp::socket in{io};
+    
+    Connection() {
+        tcp::acceptor acceptor(io, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        out.connect(acceptor.local_endpoint());
+        in = acceptor.accept();
+    }
+};
+
+std::vector<SocketRequest> split(SocketOp op, int fd, std::string& data, const std::vector<size_t>& sizes) {
+    std::vector<SocketRequest> requests;
+    size_t offset = 0;
+    for (size_t i = 0; offset < data.size(); ++i) {
+        size_t length = std::min(sizes[i % sizes.size()], data.size() - offset);
+        requests.push_back({op, fd, data.data() + offset, length});
+        offset += length;
+    }
+    return requests;
+}
+
+void testStream(bool prefer_io_uring, size_t zero_copy_threshold) {
+    auto sender = createSocketBackend(prefer_io_uring, zero_copy_threshold);
+    auto receiver = createSocketBackend(prefer_io_uring, zero_copy_threshold);
+    Connection connection;
+    // The receiving end is non-blocking, as an event loop would keep it
+    connection.in.non_blocking(true);
+    
+    // Several MiB so sends block on a full socket buffer midway
+    std::string sent(6 * 1024 * 1024 + 7, '\0');
+    for (size_t i = 0; i < sent.size(); ++i) {
+        sent[i] = static_cast<char>(i * 131 + i / 4093);
+    }
+    std::string received(sent.size(), '\0');
+    
+    auto sends = split(SocketOp::SEND, connection.out.native_handle(), sent, {1, 16384, 1 << 20, 3, 65536});
+    auto recvs = split(SocketOp::RECV, connection.in.native_handle(), received, {16384, 5, 300000});
+    std::thread writer([&] { sender->submit(sends); });
+    receiver->submit(recvs);
+    writer.join();
+    
+    CHECK(received == sent);
+    CHECK(sender->getStats().bytes == sent.size());
+    CHECK(receiver->getStats().requests == recvs.size());
+    if (sender->name() == "io_uring_zc") {
+        CHECK(sender->getStats().zero_copy_sends > 0);
+    }
+    
+    // A hang-up fails the pending receive instead of waiting forever
+    connection.out.close();
+    char byte;
+    bool threw = false;
+    try {
+        receiver->submit({{SocketOp::RECV, connection.in.native_handle(), &byte, 1}});
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+} // namespace
+
+int main() {
+    testStream(false, 0);
+    testStream(true, 0);
+    testStream(true, 16384);
+    return 0;
+}
@@ -0,0 +1,155 @@
+// WebSeedClient against in-process HTTP range servers: it must leave pieces
+// reserved by other downloaders alone, survive seeds serving corrupt data
+// or stalling midway, and reuse its keep-alive connections.
+
+#include "check.hpp"
+#include "http_range_server.hpp"
+#include "synthetic_torrent.hpp"
+#include "piece_picker.hpp"
+#include "piece_storage.hpp"
+#include "torrent_file.hpp"
+#include "web_seed.hpp"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t PIECE_LENGTH = 16 * 1024;
+constexpr size_t CONNECTIONS = 4;
+
+std::string testDir(const std::string& name) {
+    auto dir = std::filesystem::temp_directory_path() / ("bittorrent_web_seed_test_" + name);
+    std::filesystem::remove_all(dir);
+    return dir.string();
+}
+
+support::SyntheticTorrent makeTorrent(const std::string& dir, const std::vector<std::string>& seeds) {
+    return support::makeSyntheticTorrent(
+        dir, "seeded", {{"a.bin", 100000}, {"sub/b.bin", 300001}, {"c.bin", 3}}, PIECE_LENGTH, true, seeds);
+}
+
+void testReservedPiecesSkipped() {
+    std::string dir = testDir("reserved");
+    // The server needs the content before the torrent can name its URL
+    auto content = makeTorrent(dir, {});
+    support::HttpRangeServer server(content.urlPaths());
+    auto synthetic = makeTorrent(dir, {server.baseUrl()});
+    TorrentFile torrent(synthetic.torrent_path);
+    CHECK(torrent.getWebSeeds() == std::vector<std::string>{server.baseUrl()});
+    
+    PiecePicker picker(torrent.getNumPieces());
+    PieceStorage storage(torrent, dir + "/download");
+    
+    // Pieces a peer is already downloading
+    std::vector<bool> all(torrent.getNumPieces(), true);
+    std::vector<size_t> reserved;
+    uint64_t reserved_bytes = 0;
+    for (size_t i = 0; i < 3; ++i) {
+        reserved.push_back(*picker.reservePiece(all));
+        reserved_bytes += torrent.getPieceSize(reserved.back());
+    }
+    
+    WebSeedClient client(torrent, storage, picker, torrent.getWebSeeds(), CONNECTIONS);
+    CHECK(client.run() == torrent.getNumPieces() - reserved.size());
+    CHECK(server.getBytesServed() == torrent.getInfo().total_length - reserved_bytes);
+    for (size_t piece : reserved) {
+        CHECK(!picker.havePiece(piece));
+        CHECK(picker.isReserved(piece));
+    }
+    
+    // The peer gives up; now the web seed takes them
+    for (size_t piece : reserved) {
+        picker.releasePiece(piece);
+    }
+    CHECK(client.run() == reserved.size());
+    CHECK(picker.isComplete());
+    for (size_t piece = 0; piece < torrent.getNumPieces(); ++piece) {
+        CHECK(storage.verifyPiece(piece));
+    }
+    CHECK(server.getConnections() <= CONNECTIONS);
+    std::filesystem::remove_all(dir);
+}
+
+void testCorruptSeed() {
+    std::string dir = testDir("corrupt");
+    auto content = makeTorrent(dir, {});
+    support::HttpRangeServer bad(content.urlPaths());
+    support::HttpRangeServer good(content.urlPaths());
+    bad.corrupt("/seeded/sub/b.bin");
+    auto synthetic = makeTorrent(dir, {bad.baseUrl(), good.baseUrl()});
+    TorrentFile torrent(synthetic.torrent_path);
+    
+    PiecePicker picker(torrent.getNumPieces());
+    PieceStorage storage(torrent, dir + "/download");
+    WebSeedClient client(torrent, storage, picker, torrent.getWebSeeds(), CONNECTIONS);
+    client.run();
+    
+    CHECK(picker.isComplete());
+    CHECK(client.getStats().pieces_failed > 0);
+    for (size_t piece = 0; piece < torrent.getNumPieces(); ++piece) {
+        CHECK(storage.verifyPiece(piece));
+        CHECK(!picker.isReserved(piece));
+    }
+    std::filesystem::remove_all(dir);
+}
+
+void testStalledSeed() {
+    std::string dir = testDir("stalled");
+    auto content = makeTorrent(dir, {});
+    support::HttpRangeServer stalled(content.urlPaths());
+    support::HttpRangeServer good(content.urlPaths());
+    stalled.stall("/seeded/a.bin");
+    stalled.stall("/seeded/sub/b.bin");
+    auto synthetic = makeTorrent(dir, {stalled.baseUrl(), good.baseUrl()});
+    TorrentFile torrent(synthetic.torrent_path);
+    
+    PiecePicker picker(torrent.getNumPieces());
+    PieceStorage storage(torrent, dir + "/download");
+    WebSeedClient client(torrent, storage, picker, torrent.getWebSeeds(), CONNECTIONS);
+    client.setStallTimeout(1);
+    auto started = std::chrono::steady_clock::now();
+    client.run();
+    
+    // Stalled requests time out and their pieces go to the other seed
+    CHECK(std::chrono::steady_clock::now() - started < std::chrono::seconds(20));
+    CHECK(picker.isComplete());
+    CHECK(client.getStats().pieces_failed > 0);
+    for (size_t piece = 0; piece < torrent.getNumPieces(); ++piece) {
+        CHECK(storage.verifyPiece(piece));
+        CHECK(!picker.isReserved(piece));
+    }
+    std::filesystem::remove_all(dir);
+}
+
+void testThroughput() {
+    std::string dir = testDir("throughput");
+    auto content = support::makeSyntheticTorrent(dir, "big.bin", {{"big.bin", 32 << 20}}, 256 * 1024);
+    support::HttpRangeServer server(content.urlPaths());
+    auto synthetic = support::makeSyntheticTorrent(dir, "big.bin", {{"big.bin", 32 << 20}}, 256 * 1024,
+                                                   false, {server.baseUrl()});
+    TorrentFile torrent(synthetic.torrent_path);
+    
+    PiecePicker picker(torrent.getNumPieces());
+    PieceStorage storage(torrent, dir + "/download");
+    WebSeedClient client(torrent, storage, picker, torrent.getWebSeeds(), CONNECTIONS);
+    CHECK(client.run() == torrent.getNumPieces());
+    CHECK(server.getConnections() <= CONNECTIONS);
+    
+    const auto& stats = client.getStats();
+    std::printf("32 MiB from a loopback web seed: %.1f MB/s, %zu requests over %zu connections\n",
+                stats.megabytesPerSecond(), stats.requests, server.getConnections());
+    std::filesystem::remove_all(dir);
+}
+
+} // namespace
+
+int main() {
+    testReservedPiecesSkipped();
+    testCorruptSeed();
+    testStalledSeed();
+    testThroughput();
+    return 0;
+}